@@ -64,6 +64,11 @@
 /******** imutil.h ********
    Header file for the imutil.c source code.  Image utility routines.
 
+/******** parallel.h ********
+   Header file for the parallel.c source code.  Fork-join helpers around
+   POSIX threads for the array-based routines, and chunked parallel parsing
+   of line-oriented files.
+
 /******** photom.h ********
    Header file for photometry-related funtions needed for various
    astronomical calculations.
@@ -71,11 +76,19 @@
 /******** read_dat_files.h ********
    Header file for the read_ncolumn routines, plus countlines().
 
+/******** skyindex.h ********
+   Header file for the skyindex.c source code.  Hierarchical Triangular
+   Mesh index over arrays of sky positions, for cone & box searches.
+
 /******** strings.h ********
    Header file to accompany the strings library routines.
 
 /******** window.h ********
    Header definitions for various apodization window functions.
+
+/******** xmatch.h ********
+   Header file for the xmatch.c source code.  Multithreaded positional
+   cross-matching of two catalogs with the zone algorithm.
 */
 
 
@@ -85,6 +98,16 @@
 #include <math.h>
 #endif
 
+#ifndef HAVE_TIME_H
+#define HAVE_TIME_H
+#include <time.h>
+#endif
+
+#ifndef HAVE_SYS_STAT_H
+#define HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
 #ifndef HAVE_FITSIO_H
 #define HAVE_FITSIO_H
 #include <fitsio.h>
@@ -98,11 +121,28 @@
 #define ATIME_LOCAL 45
 #define ATIME_GMT   46
 
+#define ATIME_LST_REANCHOR 4096  // Steps between exact LST evaluations
+
 #define COORD_RA  360  //  c_type definitions for deg/dms routine
 #define COORD_DEC 180
 #define COORD_LST 24
 
+#define COORD_FMT_LEN 24  // Room for any coord_format_dms() string
+
+#define COORD_OK       0  // Return codes of the coord_scan_*() routines
+#define COORD_ESYNTAX -1
+#define COORD_ERANGE  -2
+
 #define CATALOG_PA -500.  // If 'Parallactic Angle'
+#define CATALOG_LIB 1     // Catalog formats
+#define CATALOG_MMT 2
+#define CATALOG_TUI 3
+#define CATALOG_OBS 4     // Observatory list, read as astrom_location
+#define CATALOG_STREAM_BUF 1048576  // Read buffer of a catalog_stream
+#define CATALOG_WRITE_BUF  4194304  // Output buffer of the writers
+#define CATALOG_LIB_LINE   106      // Bytes per Master Catalog line
+#define CATALOG_CACHE_VERSION 1
+#define CATALOG_CACHE_EXT     ".tpc"  // Sidecar binary cache suffix
 #define STRINGS_LEN 256
 
 #define DEG2RAD M_PI/180.  // Radian --> Deg & Deg --> Radian conversions
@@ -110,6 +150,14 @@
 #define TWOPI   (M_PI*2.)
 //#define OBSFILE "/d1/observing/Library/observatories.dat"
 
+#define PARALLEL_MAX_THREADS 256
+
+#define XMATCH_BEST 1  // Nearest match only, for each entry of catalog 1
+#define XMATCH_ALL  2  // Every pair within the match radius
+
+#define SKYINDEX_DEPTH     10  // Default HTM leaf depth (~0.1 deg trixels)
+#define SKYINDEX_MAX_DEPTH 20
+
 #define FITSWRAP_NOFILE_EXIT 2104  // Codes used by fitswrap_catcherror()
 #define FITSWRAP_NOFILE_CONT 2105
 #define FITSWRAP_EOF_ERROR   2106
@@ -130,6 +178,25 @@ typedef struct{
   double sec;
 } atime_time;      // Astronomical Time
 
+// Time context:  one instant, and the quantities derived from it
+typedef struct {
+  atime_time date;      // GMT date & time
+  double jd;            // JD of the instant
+  double jd_0h;         // JD at 0h GMT of the date
+  double T;             // Julian centuries from J2000.0 to jd_0h
+  double gmst;          // Greenwich sidereal time (degrees)
+} atime_context;
+
+// Sidereal time stepper over a uniform JD grid
+typedef struct {
+  double longitude;     // Longitude, +WEST
+  double jd0;           // Start of the grid
+  double step;          // Grid step (days)
+  long   k;             // Index of the current grid point
+  double lst;           // LST at grid point k (degrees)
+  double dlst;          // LST increment per step (degrees)
+} atime_lst_stepper;
+
 // Celestial Coordinates
 typedef struct {
   double ra;            // RA measured in DDD.DDDDDDD
@@ -151,6 +218,28 @@ typedef struct {
   int    tz;            // Location time zone (i.e. GMT-7)
 } astrom_location;
 
+// Prepared observer site, see astrom_site_prepare()
+typedef struct {
+  astrom_location loc;  // The site itself
+  double sin_lat;       // Latitude trig
+  double cos_lat;
+  double jd_0h;         // JD at 0h UT of the prepared date
+  double theta0;        // Greenwich sidereal time at jd_0h (degrees)
+  double jd_anchor;     // LST model:  lst = lst_anchor +
+  double lst_anchor;    //                   lst_rate * (jd - jd_anchor)
+  double lst_rate;      // Degrees per day
+  double refr_scale;    // Refraction pressure/temperature factor
+} astrom_site;
+
+// Observatory registry, see astrom_registry_load()
+typedef struct {
+  int    n;             // Number of sites
+  astrom_location *sites;
+  int    nbuckets;      // Size of each hash table (power of 2)
+  int   *by_num;        // Hash tables of site indices, -1 if empty
+  int   *by_name;
+} astrom_registry;
+
 // Rise/Transit/Set Day Fractions
 typedef struct {
   double m0;
@@ -158,6 +247,51 @@ typedef struct {
   double m2;
 } astrom_rst;
 
+// Prepared (unit-vector) form of a set of positions, see astrom_prepare()
+typedef struct {
+  int     n;            // Number of positions
+  double *x;            // Cartesian unit vector components
+  double *y;
+  double *z;
+  double *sin_dec;      // Cached trig of the declinations
+  double *cos_dec;
+  double *ra;           // Original coordinates, ddd.dddddd
+  double *dec;
+} astrom_prepared;
+
+// HTM sky index over a set of positions, see skyindex.c
+typedef struct {
+  int     n;            // Number of indexed positions
+  int     depth;        // HTM level of the leaf trixels
+  unsigned long long *htmid;   // Leaf trixel ID of each position (sorted)
+  int    *idx;          // Catalog index of each sorted position
+  double *x;            // Unit vectors, in sorted order
+  double *y;
+  double *z;
+} skyindex;
+
+// One matched pair from the cross-match routines, see xmatch.c
+typedef struct {
+  int    i1;            // Index into catalog 1
+  int    i2;            // Index into catalog 2
+  double sep;           // Separation (degrees)
+} xmatch_pair;
+
+// Precession plan:  rotation matrix between two epochs
+typedef struct {
+  double epoch_i;       // Initial epoch, YYYY.YY
+  double epoch_f;       // Final epoch, YYYY.YY
+  double r[3][3];       // v_f = r * v_i
+} astrom_precess_plan;
+
+// Throughput report from catalog_propagate()
+typedef struct {
+  int    rows;          // Rows processed
+  int    groups;        // Distinct source epochs
+  double seconds;       // Wall-clock time
+  double rows_per_sec;
+} catalog_prop_stats;
+
 /* Catalog Structures */
 // Library Preferred catalog structure
 typedef struct {
@@ -193,6 +327,42 @@ typedef struct {
   char   keywords[100];
 } catalog_tui;
 
+// Columnar (structure-of-arrays) catalog; id & spectyp are byte offsets
+// of null-terminated strings in pool.  If map is not NULL the columns
+// point into a mapped binary cache file.
+typedef struct {
+  int     n;
+  int     format;       // CATALOG_LIB or CATALOG_MMT source
+  double *ra;
+  double *dec;
+  double *epoch;
+  float  *ra_pm;
+  float  *dec_pm;
+  float  *mag;
+  float  *color;
+  float  *pa;
+  unsigned int *id;
+  unsigned int *spectyp;
+  char   *pool;
+  size_t  poolsize;
+  void   *map;
+  size_t  maplen;
+} catalog_soa;
+
+// One-pass reader over a catalog file, see catalog_stream_open()
+typedef struct {
+  FILE   *fp;
+  int     format;       // CATALOG_LIB, _MMT, _TUI or CATALOG_OBS
+  size_t  recsize;      // Size of one output record
+  int   (*parse)(const char *line, size_t len, void *rec);
+  char   *buf;          // CATALOG_STREAM_BUF bytes of the file
+  size_t  pos;          // Next unread byte in buf
+  size_t  fill;         // Bytes of buf in use
+  int     eof;
+  int     skip;         // Discarding the tail of an over-long line
+  long    nrows;        // Records returned so far
+} catalog_stream;
+
 // Betsy Green pccb Catalog structure
 typedef struct {
   char   id[50];
@@ -203,6 +373,9 @@ typedef struct {
   float  b_v;
 } catalog_bg;
 
+// Line parser for parallel_parse_*():  fills rec from one line of len
+// characters (not null-terminated), returns 1 if a record was read
+typedef int (*parallel_line_parser)(const char *line, size_t len, void *rec);
 
 
 
@@ -213,35 +386,174 @@ typedef struct {
 // astrom.c
 double astrom_ang_sep(const astrom_coords *, const astrom_coords *);
 double astrom_ang_sep2(const astrom_coords *, const astrom_coords *);
+void   astrom_ang_sep_batch(const astrom_coords *, const double *,
+			    const double *, int, double *);
+void   astrom_ang_sep_matrix(const double *, const double *, int,
+			     const double *, const double *, int, double *);
+void   astrom_unit_vector(double, double, double *, double *, double *);
 double astrom_rel_pos_ang(const astrom_coords *, const astrom_coords *);
+astrom_prepared *astrom_prepare(const double *, const double *, int);
+astrom_prepared *astrom_prepare_lib(const catalog_lib *, int);
+astrom_prepared *astrom_prepare_mmt(const catalog_mmt *, int);
+astrom_prepared *astrom_prepare_soa(const catalog_soa *);
+astrom_prepared *astrom_prepared_alloc(int);
+void   astrom_prepared_free(astrom_prepared *);
+double astrom_prep_sep(const astrom_prepared *, int,
+		       const astrom_prepared *, int);
+double astrom_prep_pos_ang(const astrom_prepared *, int,
+			   const astrom_prepared *, int);
+int    astrom_prep_within(const astrom_prepared *, const astrom_coords *,
+			  double, int *);
 void   astrom_precess2(astrom_coords *, double, double);
+void   astrom_precess_plan_init(astrom_precess_plan *, double, double);
+astrom_precess_plan astrom_precess_plan_get(double, double);
+void   astrom_precess_apply(const astrom_precess_plan *, double *, double *,
+			    int);
+void   astrom_precess_bulk(astrom_coords *, int, double, double);
 double astrom_get_lha(double, double);
 void   astrom_get_altaz(astrom_coords *, astrom_location *, astrom_altaz *,
 			double);
+void   astrom_altaz_grid(const astrom_coords *, int, const astrom_location *,
+			 double, double, int, double *, double *, double *,
+			 int);
 astrom_rst      *astrom_get_rst(astrom_coords *,astrom_location *, 
 				double, double, int *);
+void   astrom_get_rst_batch(const astrom_coords *, int,
+			    const astrom_location *, double, double, int,
+			    astrom_rst *, int *);
+void   astrom_get_rst_range(const astrom_coords *, int,
+			    const astrom_location *, double, int, double, int,
+			    astrom_rst *, int *);
+void   astrom_site_prepare(astrom_site *, const astrom_location *, double);
+void   astrom_site_weather(astrom_site *, double, double);
+double astrom_site_lst(const astrom_site *, double);
+double astrom_site_refraction(const astrom_site *, double);
+void   astrom_get_altaz_site(const astrom_coords *, const astrom_site *,
+			     astrom_altaz *, double);
+void   astrom_get_rst_site(const astrom_coords *, const astrom_site *, double,
+			   int, astrom_rst *, int *);
 astrom_location *astrom_read_observatories(char *, int *);
+astrom_location *astrom_read_observatories_parallel(char *filename, int *n,
+						    int nthreads);
+int    astrom_parse_observatory(const char *, size_t, astrom_location *);
+astrom_registry *astrom_registry_load(char *);
+void   astrom_registry_free(astrom_registry *);
+const astrom_registry *astrom_registry_get(char *);
+const astrom_location *astrom_registry_find_num(const astrom_registry *, int);
+const astrom_location *astrom_registry_find_name(const astrom_registry *,
+						 const char *);
 astrom_location  astrom_get_location(char *);
 
 // atime.c
 atime_time *atime_get_date_now(int clock_type);
 atime_time *atime_get_date(int clock_type, int prevday);
+int         atime_clock(int clock_type, atime_time *date);
+atime_time  atime_now(int clock_type);
+void        atime_fill(time_t secs, long nsec, int clock_type,
+		       atime_time *date);
 double      atime_jd(int year, int month, double day);
 double      atime_jd_today();
 double      atime_jd_now();
 double      atime_get_lst(double longitude);
 double      atime_lst(double longitude, double jd);
+int         atime_context_now(atime_context *ctx);
+void        atime_context_at(atime_context *ctx, double jd);
+double      atime_lst_ctx(const atime_context *ctx, double longitude);
+void        atime_jd_to_date(double jd, atime_time *date);
+void        atime_lst_array(double longitude, const double *jd, int n,
+			    double *lst);
+void        atime_jd_array(const int *year, const int *month,
+			   const double *day, int n, double *jd);
+void        atime_lst_stepper_init(atime_lst_stepper *st, double longitude,
+				   double jd_start, double jd_step);
+double      atime_lst_stepper_next(atime_lst_stepper *st);
+void        atime_lst_stepper_fill(atime_lst_stepper *st, double *lst,
+				   int n);
+int         atime_iso_to_jd(const char *str, size_t len, double *jd,
+			    double *mjd);
+int         atime_iso_to_jd_array(const char **str, int n, double *jd,
+				  double *mjd);
+int         atime_jd_to_iso(double jd, int ndigits, char *buf,
+			    size_t buflen);
+long        atime_jd_to_iso_array(const double *jd, int n, int ndigits,
+				  char sep, char *buf, size_t buflen);
 char       *atime_datestring();
 
 // catalog.c
 catalog_lib *catalog_read_lib(char *filename, int *n);
+catalog_lib *catalog_read_lib_mmap(char *filename, int *n);
+catalog_lib *catalog_read_lib_parallel(char *filename, int *n, int nthreads);
+catalog_mmt *catalog_read_mmt_parallel(char *filename, int *n, int nthreads);
+catalog_tui *catalog_read_tui_parallel(char *filename, int *n, int nthreads);
+int          catalog_parse_lib_line(const char *line, size_t len,
+				    catalog_lib *rec);
+int          catalog_parse_mmt_line(const char *line, size_t len,
+				    catalog_mmt *rec);
+int          catalog_parse_tui_line(const char *line, size_t len,
+				    catalog_tui *rec);
 catalog_mmt *catalog_read_mmt(char *filename, int *n);
 catalog_tui *catalog_read_tui(char *filename, int *n);
+void         catalog_write_lib(char *filename, const catalog_lib *objects,
+			       int n);
+void         catalog_write_lib_mmap(char *filename,
+				    const catalog_lib *objects, int n,
+				    int nthreads);
+void         catalog_write_mmt(char *filename, const catalog_mmt *objects,
+			       int n);
+void         catalog_write_tui(char *filename, const catalog_tui *objects,
+			       int n);
+catalog_stream *catalog_stream_open(char *filename, int format);
+int          catalog_stream_next(catalog_stream *st, void *recs, int k);
+void         catalog_stream_close(catalog_stream *st);
+long         catalog_foreach(char *filename, int format,
+			     int (*fn)(void *rec, void *user), void *user);
+void         catalog_propagate(double *ra, double *dec, const float *ra_pm,
+			       const float *dec_pm, const double *epoch, int n,
+			       double epoch_f, int nthreads,
+			       catalog_prop_stats *stats);
+void         catalog_propagate_lib(catalog_lib *objects, int n,
+				   double epoch_f, double *ra_out,
+				   double *dec_out, int nthreads,
+				   catalog_prop_stats *stats);
+catalog_soa *catalog_soa_from_lib(const catalog_lib *objects, int n);
+catalog_soa *catalog_soa_from_mmt(const catalog_mmt *objects, int n);
+catalog_lib *catalog_soa_to_lib(const catalog_soa *cat);
+catalog_mmt *catalog_soa_to_mmt(const catalog_soa *cat);
+const char  *catalog_soa_id(const catalog_soa *cat, int i);
+const char  *catalog_soa_spectyp(const catalog_soa *cat, int i);
+int         *catalog_soa_mag_cut(const catalog_soa *cat, float mag_min,
+				 float mag_max, int *nfound);
+int         *catalog_soa_cone(const catalog_soa *cat,
+			      const astrom_coords *center, double radius,
+			      int *nfound);
+void         catalog_soa_free(catalog_soa *cat);
+int          catalog_cache_write(const catalog_soa *cat, char *filename,
+				 const struct stat *source);
+catalog_soa *catalog_cache_map(char *filename, const struct stat *source);
+catalog_soa *catalog_read_lib_cached(char *filename, int nthreads);
+catalog_soa *catalog_read_mmt_cached(char *filename, int nthreads);
+void         catalog_propagate_mmt(catalog_mmt *objects, int n,
+				   double epoch_f, double *ra_out,
+				   double *dec_out, int nthreads,
+				   catalog_prop_stats *stats);
 
 // coord.c
 astrom_coords coord_parserd(char *);
 double        coord_dmstodeg(double dms[3], int c_type);
 void          coord_degtodms(double, char *, int c_type);
+int           coord_format_dms(double deg, int c_type, int ndigits,
+			       char *buf, size_t buflen);
+long          coord_format_dms_array(const double *deg, int n, int c_type,
+				     int ndigits, char sep, char *buf,
+				     size_t buflen);
+long          coord_format_rd_array(const double *ra, const double *dec,
+				    int n, char *buf, size_t buflen);
+int           coord_scan_rd(const char *str, size_t len,
+			    astrom_coords *object);
+int           coord_scan_angle(const char *str, size_t len, int c_type,
+			       double *deg);
+int           coord_scan_rd_array(const char **str, int n,
+				  astrom_coords *object, int *status);
 
 // fileio.c
 FILE *fileopenr(char *);
@@ -249,6 +561,8 @@ FILE *fileopenw(char *);
 FILE *fileopenrb(char *);
 FILE *fileopenwb(char *);
 FILE *fileopenwa(char *);
+char *filemapr(char *, size_t *);
+void  fileunmap(char *, size_t);
 void  make_filename(char *,char *,char *,char *);
 
 // fitswrap.c
@@ -258,6 +572,7 @@ double  **fitswrap_read2array(fitsfile *fitsfp, long xystart[2], long xysize[2],
 			      int data_type, int *status);
 void      fitswrap_write2file(char *fileout, char *copyhdr, double **array, 
 			  long subsize[2], int *status);
+void      fitswrap_timestamp(time_t now, char *buf_date, char *buf_time);
 void      fitswrap_catcherror(int *status);
 
 // imutil.c
@@ -267,6 +582,15 @@ double  *imutil_2d_to_1d(double **, long *);
 double **imutil_get_subsection(double **, long *, long *, long *);
 void     imutil_transpose(double **, double **, int, int);
 
+// parallel.c
+int   parallel_nthreads(int requested);
+void *parallel_parse_buffer(const char *buf, size_t len, size_t recsize,
+			    parallel_line_parser parse, int nthreads, int *n);
+void *parallel_parse_file(char *filename, size_t recsize,
+			  parallel_line_parser parse, int nthreads, int *n);
+void  parallel_run(int nthreads, void *(*worker)(void *), void *args,
+		   size_t argsize);
+
 // photom.c
 double photom_spect_countrate(double, double, double, double, double);
 
@@ -275,14 +599,40 @@ int     countlines(FILE *fp);
 double *read_ncolumn(char *filename, int *N, int m);
 double *parse_array(double *total_array, int n_lines, int n_dim);
 
+// skyindex.c
+skyindex *skyindex_build(const double *ra, const double *dec, int n,
+			 int depth);
+skyindex *skyindex_build_lib(const catalog_lib *objects, int n, int depth);
+skyindex *skyindex_build_soa(const catalog_soa *cat, int depth);
+void      skyindex_free(skyindex *index);
+int      *skyindex_cone(const skyindex *index, const astrom_coords *center,
+			double radius, int *n);
+int      *skyindex_box(const skyindex *index, double ra_min, double ra_max,
+		       double dec_min, double dec_max, int *n);
+
 // strings.c
-int strings_getline(FILE *, char *, size_t *);
+int   strings_getline(FILE *, char *, size_t *);
+char *strings_put_fixed(char *p, double val, int width, int ndigits);
+char *strings_put_padded(char *p, const char *str, int width);
 
 // window.c
 void window_andrew(double *array, int length, int n);
 void window_hann(double *array, int length);
 void window_hamming();
 
+// xmatch.c
+xmatch_pair *xmatch_radec(const double *ra1, const double *dec1, int n1,
+			  const double *ra2, const double *dec2, int n2,
+			  double radius, int mode, int nthreads, int *npairs);
+xmatch_pair *xmatch_lib(const catalog_lib *cat1, int n1,
+			const catalog_lib *cat2, int n2, double radius,
+			int mode, int nthreads, int *npairs);
+xmatch_pair *xmatch_mmt(const catalog_mmt *cat1, int n1,
+			const catalog_mmt *cat2, int n2, double radius,
+			int mode, int nthreads, int *npairs);
+xmatch_pair *xmatch_soa(const catalog_soa *cat1, const catalog_soa *cat2,
+			double radius, int mode, int nthreads, int *npairs);
+
 
 
 
@@ -10,6 +10,12 @@
    Calling sequences:
      ang_sep_deg = angular_separation(&star1, &star2); -- in degrees
      rel_pos_ang = rel_position_angle(&star1, &star2); -- deg EofN  1 wrt 2
+     astrom_ang_sep_batch(&ref, ra, dec, n, sep);   -- 1 vs. n, degrees
+     astrom_ang_sep_matrix(ra1,dec1,n1, ra2,dec2,n2, sep); -- n1 x n2
+     prep = astrom_prepare_lib(catalog, n);  -- unit vectors, cached trig
+     astrom_prep_sep(prep, i, prep, j);      -- trig-free separation
+     astrom_precess_bulk(positions, n, 1950.0, 2000.0);  -- whole arrays
+     astrom_altaz_grid(targets, n, &site, jd0, step, m, alt, az, X, 0);
 
      
 
@@ -19,9 +25,43 @@
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <pthread.h>
 
 #include <tpeb.h>
 
+#define ASTROM_BLOCK 256    // Block length for the batched (array) routines
+#define ASTROM_PLAN_CACHE 8 // Number of precession plans kept
+#define ASTROM_REGISTRY_BLOCK 4  // Initial length of the registry list
+
+// Per-thread work block for astrom_altaz_grid()
+typedef struct {
+  const astrom_coords *targets;
+  double  sin_phi;      // Site latitude trig
+  double  cos_phi;
+  const double *cos_lst;   // LST trig at each time step
+  const double *sin_lst;
+  int     m;            // Number of time steps
+  int     first;        // Targets handled by this thread
+  int     last;
+  double *alt;          // Outputs, n x m
+  double *az;
+  double *airmass;
+} astrom_grid_work;
+
+static void *astrom_grid_worker(void *arg);
+static void  astrom_rst_one(const astrom_coords *object, double sin_phi,
+			    double cos_phi, double L, double theta0,
+			    double alt, int refine, astrom_rst *times,
+			    int *updown);
+static void  astrom_field(char *dst, const char *line, size_t len, int start,
+			  int width);
+static int astrom_observatory_line(const char *line, size_t len, void *rec);
+static unsigned int astrom_hash_num(int num);
+static unsigned int astrom_hash_name(const char *name);
+static int   astrom_name_cmp(const char *a, const char *b);
+
 /* Function for calculating angular separation
    Algorithm from "Astronomical Algorithms, 2nd ed", Ch 17, by Jean Meeus */
 double astrom_ang_sep(const astrom_coords *star1, 
@@ -98,6 +138,114 @@ double astrom_ang_sep2(const astrom_coords *star1,
 }
 
 
+/* Function for calculating the angular separations between one reference
+   position and n positions held as contiguous RA & Dec (degree) columns.
+   Same haversine as astrom_ang_sep(), which remains the accuracy reference,
+   but the reference trig is computed once and the work is done in blocks
+   of simple loops so the compiler can vectorize them.  sep[] in degrees. */
+void astrom_ang_sep_batch(const astrom_coords *ref, const double *ra,
+			  const double *dec, int n, double *sep){
+  
+  /* Variable Declarations */
+  int i,j,nb;
+  double ra0,dec0,cos_dec0,h;
+  double hdra[ASTROM_BLOCK],hddec[ASTROM_BLOCK],cdec[ASTROM_BLOCK];
+  
+  /* Reference position converted once, outside of the loop */
+  ra0      = ref->ra  * DEG2RAD;
+  dec0     = ref->dec * DEG2RAD;
+  cos_dec0 = cos(dec0);
+  
+  for(i=0; i<n; i+=ASTROM_BLOCK){
+    nb = (n - i < ASTROM_BLOCK) ? n - i : ASTROM_BLOCK;
+    
+    // Half-angle differences & second declination, in radians
+    for(j=0; j<nb; j++){
+      hdra[j]  = (ra0  - ra[i+j]  * DEG2RAD) / 2.;
+      hddec[j] = (dec0 - dec[i+j] * DEG2RAD) / 2.;
+      cdec[j]  = dec[i+j] * DEG2RAD;
+    }
+    
+    // Trig over the block -- one function per loop
+    for(j=0; j<nb; j++)
+      hdra[j]  = sin(hdra[j]);
+    for(j=0; j<nb; j++)
+      hddec[j] = sin(hddec[j]);
+    for(j=0; j<nb; j++)
+      cdec[j]  = cos(cdec[j]);
+    
+    // Equation 17.5 (Meeus), clipped against round-off above 1
+    for(j=0; j<nb; j++){
+      h = hddec[j] * hddec[j] + cos_dec0 * cdec[j] * hdra[j] * hdra[j];
+      if(h > 1.) h = 1.;
+      sep[i+j] = 2. * asin(sqrt(h)) * RAD2DEG;
+    }
+  }
+  
+  return;
+}
+
+
+/* Function for calculating the full n1 x n2 matrix of angular separations
+   between two sets of positions held as RA & Dec (degree) columns.
+   sep[i*n2 + j] is the separation (degrees) between set-1 entry i and
+   set-2 entry j.  Set 2 is converted to unit vectors once, so the inner
+   loop is a chord length:  d = 2 asin(|v1 - v2| / 2).                   */
+void astrom_ang_sep_matrix(const double *ra1, const double *dec1, int n1,
+			   const double *ra2, const double *dec2, int n2,
+			   double *sep){
+  
+  /* Variable Declarations */
+  int i,j;
+  double *x,*y,*z,x1,y1,z1,dx,dy,dz,c;
+  double *row;
+  
+  x = (double *)malloc(3 * n2 * sizeof(double));
+  y = x + n2;
+  z = y + n2;
+  
+  /* Unit vectors for the second set */
+  for(j=0; j<n2; j++)
+    astrom_unit_vector(ra2[j], dec2[j], &x[j], &y[j], &z[j]);
+  
+  /* One row of the output matrix per entry in the first set */
+  for(i=0; i<n1; i++){
+    astrom_unit_vector(ra1[i], dec1[i], &x1, &y1, &z1);
+    row = sep + (size_t)i * n2;
+    
+    for(j=0; j<n2; j++){
+      dx = x1 - x[j];
+      dy = y1 - y[j];
+      dz = z1 - z[j];
+      c  = sqrt(dx*dx + dy*dy + dz*dz) / 2.;
+      if(c > 1.) c = 1.;
+      row[j] = 2. * asin(c) * RAD2DEG;
+    }
+  }
+  
+  free(x);
+  
+  return;
+}
+
+
+/* Function for converting RA & Dec (degrees) to a Cartesian unit vector */
+void astrom_unit_vector(double ra, double dec, double *x, double *y,
+			double *z){
+  
+  /* Variable Declarations */
+  double alpha = ra  * DEG2RAD;
+  double delta = dec * DEG2RAD;
+  double cos_delta = cos(delta);
+  
+  *x = cos_delta * cos(alpha);
+  *y = cos_delta * sin(alpha);
+  *z = sin(delta);
+  
+  return;
+}
+
+
 /* Function for calculating relative position angle (obj1 wrt obj 2)
    Algorithm from "Astronomical Algorithms, 2nd ed", Ch 17, by Jean Meeus */
 double astrom_rel_pos_ang(const astrom_coords *star1, 
@@ -134,6 +282,186 @@ double astrom_rel_pos_ang(const astrom_coords *star1,
 }
 
 
+/* Function for building the prepared (unit-vector) form of n positions
+   given as RA & Dec (degree) columns.  The trig is done here, once, so that
+   the astrom_prep_*() routines below need only dot & cross products.
+   Free with astrom_prepared_free().                                       */
+astrom_prepared *astrom_prepare(const double *ra, const double *dec, int n){
+  
+  /* Variable Declarations */
+  int i;
+  double alpha,delta;
+  astrom_prepared *prep;
+  
+  prep = astrom_prepared_alloc(n);
+  
+  for(i=0; i<n; i++){
+    alpha = ra[i]  * DEG2RAD;
+    delta = dec[i] * DEG2RAD;
+    
+    prep->ra[i]      = ra[i];
+    prep->dec[i]     = dec[i];
+    prep->sin_dec[i] = sin(delta);
+    prep->cos_dec[i] = cos(delta);
+    prep->x[i]       = prep->cos_dec[i] * cos(alpha);
+    prep->y[i]       = prep->cos_dec[i] * sin(alpha);
+    prep->z[i]       = prep->sin_dec[i];
+  }
+  
+  return prep;
+}
+
+
+/* Function for building the prepared form of a catalog_lib array */
+astrom_prepared *astrom_prepare_lib(const catalog_lib *objects, int n){
+  
+  /* Variable Declarations */
+  int i;
+  double *radec;
+  astrom_prepared *prep;
+  
+  /* Gather the coordinates into columns, then prepare */
+  radec = (double *)malloc(2 * n * sizeof(double));
+  for(i=0; i<n; i++){
+    radec[i]   = objects[i].ra;
+    radec[n+i] = objects[i].dec;
+  }
+  
+  prep = astrom_prepare(radec, radec + n, n);
+  
+  free(radec);
+  
+  return prep;
+}
+
+
+/* Function for building the prepared form of a catalog_mmt array */
+astrom_prepared *astrom_prepare_mmt(const catalog_mmt *objects, int n){
+  
+  /* Variable Declarations */
+  int i;
+  double *radec;
+  astrom_prepared *prep;
+  
+  /* Gather the coordinates into columns, then prepare */
+  radec = (double *)malloc(2 * n * sizeof(double));
+  for(i=0; i<n; i++){
+    radec[i]   = objects[i].ra;
+    radec[n+i] = objects[i].dec;
+  }
+  
+  prep = astrom_prepare(radec, radec + n, n);
+  
+  free(radec);
+  
+  return prep;
+}
+
+
+/* Function for building the prepared form of a columnar catalog -- its
+   RA & Dec columns are used directly, with no gather */
+astrom_prepared *astrom_prepare_soa(const catalog_soa *cat){
+  return astrom_prepare(cat->ra, cat->dec, cat->n);
+}
+
+
+/* Function to allocate an (empty) prepared structure with room for n
+   positions -- all columns live in a single block of memory */
+astrom_prepared *astrom_prepared_alloc(int n){
+  
+  /* Variable Declarations */
+  astrom_prepared *prep;
+  
+  prep = (astrom_prepared *)malloc(sizeof(astrom_prepared));
+  
+  prep->n       = n;
+  prep->x       = (double *)malloc(7 * (size_t)n * sizeof(double));
+  prep->y       = prep->x + n;
+  prep->z       = prep->y + n;
+  prep->sin_dec = prep->z + n;
+  prep->cos_dec = prep->sin_dec + n;
+  prep->ra      = prep->cos_dec + n;
+  prep->dec     = prep->ra + n;
+  
+  return prep;
+}
+
+
+/* Function to free the memory associated with a prepared structure */
+void astrom_prepared_free(astrom_prepared *prep){
+  
+  if(prep == NULL)
+    return;
+  
+  free(prep->x);
+  free(prep);
+  
+  return;
+}
+
+
+/* Function for calculating the angular separation (degrees) between entry i
+   of prepared set a and entry j of prepared set b.
+      d = atan2( |v1 x v2| , v1 . v2 )  -- good at all separations      */
+double astrom_prep_sep(const astrom_prepared *a, int i,
+		       const astrom_prepared *b, int j){
+  
+  /* Variable Declarations */
+  double cx,cy,cz,dot;
+  
+  cx  = a->y[i] * b->z[j] - a->z[i] * b->y[j];
+  cy  = a->z[i] * b->x[j] - a->x[i] * b->z[j];
+  cz  = a->x[i] * b->y[j] - a->y[i] * b->x[j];
+  dot = a->x[i] * b->x[j] + a->y[i] * b->y[j] + a->z[i] * b->z[j];
+  
+  return atan2(sqrt(cx*cx + cy*cy + cz*cz), dot) * RAD2DEG;
+}
+
+
+/* Function for calculating relative position angle (entry i of a wrt entry
+   j of b), as astrom_rel_pos_ang() but from the unit vectors:
+      tan P = (y1 x2 - x1 y2) / (cos^2 dec2 * z1 - z2 * (x1 x2 + y1 y2))  */
+double astrom_prep_pos_ang(const astrom_prepared *a, int i,
+			   const astrom_prepared *b, int j){
+  
+  /* Variable Declarations */
+  double theta,num,den;
+  
+  num = a->y[i] * b->x[j] - a->x[i] * b->y[j];
+  den = b->cos_dec[j] * b->cos_dec[j] * a->z[i] -
+    b->z[j] * (a->x[i] * b->x[j] + a->y[i] * b->y[j]);
+  
+  theta = atan2(num, den) * RAD2DEG;
+  
+  if(theta < 0.)
+    theta += 360.;      // 0 < theta < 360
+  
+  return theta;
+}
+
+
+/* Function for finding the entries of a prepared set lying within radius
+   (degrees) of a center.  Indices are written into idx[] (which must have
+   room for prep->n entries); returns the number found.
+   The test is a single dot product per entry:  v . v_c >= cos(radius)    */
+int astrom_prep_within(const astrom_prepared *prep,
+		       const astrom_coords *center, double radius, int *idx){
+  
+  /* Variable Declarations */
+  int i,nfound=0;
+  double cx,cy,cz,cos_r;
+  
+  astrom_unit_vector(center->ra, center->dec, &cx, &cy, &cz);
+  cos_r = cos(radius * DEG2RAD);
+  
+  for(i=0; i<prep->n; i++)
+    if(prep->x[i]*cx + prep->y[i]*cy + prep->z[i]*cz >= cos_r)
+      idx[nfound++] = i;
+  
+  return nfound;
+}
+
+
 /* Function for calculating the precession of coordinates 
    Algorithm from "Astronomical Algorithms, 2nd ed", Ch 21, by Jean Meeus */
 void astrom_precess2(astrom_coords *position, double epoch_i, double epoch_f){
@@ -185,6 +513,183 @@ void astrom_precess2(astrom_coords *position, double epoch_i, double epoch_f){
 }
 
 
+/* Function for setting up a precession plan:  the rotation matrix taking
+   equatorial unit vectors from epoch_i to epoch_f, built once from the
+   same zeta, z & theta as astrom_precess2() (Meeus, Ch 21):
+      P = R_z(z) * R_y(-theta) * R_z(zeta)                               */
+void astrom_precess_plan_init(astrom_precess_plan *plan, double epoch_i,
+			      double epoch_f){
+  
+  /* Variable Declarations */
+  int i,j,k;
+  double T,t,zeta,zed,theta;
+  double rz1[3][3],ry[3][3],rz2[3][3],tmp[3][3];
+  
+  /* Input epochs in year format YYYY.YY */
+  
+  T = (epoch_i - 2000.0) / 100.;
+  t = (epoch_f - epoch_i)/ 100.;
+  
+  /* Calculate angles in degrees*DEG2RAD (ending in radians) */
+  
+  zeta  = ((2306.2181+1.39656*T-0.000139*T*T)*t + 
+	   (0.30188-0.000344*T)*t*t + 0.017998*t*t*t)/3600.*DEG2RAD;
+  zed   = ((2306.2181+1.39656*T-0.000139*T*T)*t + 
+	   (1.09468+0.000066*T)*t*t + 0.018203*t*t*t)/3600.*DEG2RAD;
+  theta = ((2004.3109-0.85330*T-0.000217*T*T)*t - 
+	   (0.42665+0.000217*T)*t*t - 0.041833*t*t*t)/3600.*DEG2RAD;
+  
+  /* The three elementary rotations */
+  memset(rz1, 0, sizeof(rz1));
+  memset(ry,  0, sizeof(ry));
+  memset(rz2, 0, sizeof(rz2));
+  
+  rz1[0][0] = cos(zeta);  rz1[0][1] = -sin(zeta);
+  rz1[1][0] = sin(zeta);  rz1[1][1] =  cos(zeta);  rz1[2][2] = 1.;
+  
+  ry[0][0]  = cos(theta); ry[0][2]  = -sin(theta);
+  ry[2][0]  = sin(theta); ry[2][2]  =  cos(theta); ry[1][1]  = 1.;
+  
+  rz2[0][0] = cos(zed);   rz2[0][1] = -sin(zed);
+  rz2[1][0] = sin(zed);   rz2[1][1] =  cos(zed);   rz2[2][2] = 1.;
+  
+  /* P = rz2 * ry * rz1 */
+  for(i=0; i<3; i++)
+    for(j=0; j<3; j++){
+      tmp[i][j] = 0.;
+      for(k=0; k<3; k++)
+	tmp[i][j] += ry[i][k] * rz1[k][j];
+    }
+  for(i=0; i<3; i++)
+    for(j=0; j<3; j++){
+      plan->r[i][j] = 0.;
+      for(k=0; k<3; k++)
+	plan->r[i][j] += rz2[i][k] * tmp[k][j];
+    }
+  
+  plan->epoch_i = epoch_i;
+  plan->epoch_f = epoch_f;
+  
+  return;
+}
+
+
+/* Function that returns the precession plan for (epoch_i, epoch_f) from a
+   small cache of recently used plans, building it on a miss.  Safe to
+   call from several threads; the plan is returned by value.            */
+astrom_precess_plan astrom_precess_plan_get(double epoch_i, double epoch_f){
+  
+  /* Variable Declarations */
+  int i;
+  astrom_precess_plan plan;
+  static astrom_precess_plan cache[ASTROM_PLAN_CACHE];
+  static int ncache = 0, next = 0;
+  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  
+  pthread_mutex_lock(&lock);
+  for(i=0; i<ncache; i++)
+    if(cache[i].epoch_i == epoch_i && cache[i].epoch_f == epoch_f){
+      plan = cache[i];
+      pthread_mutex_unlock(&lock);
+      return plan;
+    }
+  pthread_mutex_unlock(&lock);
+  
+  /* Miss -- build outside the lock, then replace the oldest entry */
+  astrom_precess_plan_init(&plan, epoch_i, epoch_f);
+  
+  pthread_mutex_lock(&lock);
+  cache[next] = plan;
+  next = (next + 1) % ASTROM_PLAN_CACHE;
+  if(ncache < ASTROM_PLAN_CACHE)
+    ncache++;
+  pthread_mutex_unlock(&lock);
+  
+  return plan;
+}
+
+
+/* Function for applying a precession plan to n positions held as RA & Dec
+   (degree) columns, in place.  Works in blocks of plain loops so that the
+   trig and the matrix product can be vectorized.  Unlike astrom_precess2()
+   the Dec comes from atan2(z, hypot(x,y)), which holds at both poles.   */
+void astrom_precess_apply(const astrom_precess_plan *plan, double *ra,
+			  double *dec, int n){
+  
+  /* Variable Declarations */
+  int i,j,nb;
+  double ca[ASTROM_BLOCK],sa[ASTROM_BLOCK],cd[ASTROM_BLOCK],sd[ASTROM_BLOCK];
+  double x,y,z,xp,yp,zp,alpha;
+  const double (*r)[3] = plan->r;
+  
+  for(i=0; i<n; i+=ASTROM_BLOCK){
+    nb = (n - i < ASTROM_BLOCK) ? n - i : ASTROM_BLOCK;
+    
+    // Trig over the block -- one function per loop
+    for(j=0; j<nb; j++)
+      ca[j] = cos(ra[i+j] * DEG2RAD);
+    for(j=0; j<nb; j++)
+      sa[j] = sin(ra[i+j] * DEG2RAD);
+    for(j=0; j<nb; j++)
+      cd[j] = cos(dec[i+j] * DEG2RAD);
+    for(j=0; j<nb; j++)
+      sd[j] = sin(dec[i+j] * DEG2RAD);
+    
+    // Rotate, leaving the new vector in ca/sa/sd
+    for(j=0; j<nb; j++){
+      x  = cd[j] * ca[j];
+      y  = cd[j] * sa[j];
+      z  = sd[j];
+      xp = r[0][0] * x + r[0][1] * y + r[0][2] * z;
+      yp = r[1][0] * x + r[1][1] * y + r[1][2] * z;
+      zp = r[2][0] * x + r[2][1] * y + r[2][2] * z;
+      ca[j] = xp;
+      sa[j] = yp;
+      sd[j] = zp;
+    }
+    
+    // Back to RA & Dec, keeping RA within [0,360)
+    for(j=0; j<nb; j++){
+      alpha = atan2(sa[j], ca[j]) * RAD2DEG;
+      ra[i+j]  = (alpha < 0.) ? alpha + 360. : alpha;
+      dec[i+j] = atan2(sd[j], hypot(ca[j], sa[j])) * RAD2DEG;
+    }
+  }
+  
+  return;
+}
+
+
+/* Function for precessing an array of n positions from epoch_i to
+   epoch_f in place, using a cached plan and astrom_precess_apply()     */
+void astrom_precess_bulk(astrom_coords *positions, int n, double epoch_i,
+			 double epoch_f){
+  
+  /* Variable Declarations */
+  int i,j,nb;
+  double ra[ASTROM_BLOCK],dec[ASTROM_BLOCK];
+  astrom_precess_plan plan;
+  
+  plan = astrom_precess_plan_get(epoch_i, epoch_f);
+  
+  /* Gather a block into columns, rotate, scatter back */
+  for(i=0; i<n; i+=ASTROM_BLOCK){
+    nb = (n - i < ASTROM_BLOCK) ? n - i : ASTROM_BLOCK;
+    for(j=0; j<nb; j++){
+      ra[j]  = positions[i+j].ra;
+      dec[j] = positions[i+j].dec;
+    }
+    astrom_precess_apply(&plan, ra, dec, nb);
+    for(j=0; j<nb; j++){
+      positions[i+j].ra  = ra[j];
+      positions[i+j].dec = dec[j];
+    }
+  }
+  
+  return;
+}
+
+
 /* Function to calculate the LHA of an object 
    NOTE: LHA is measured in degrees */
 double astrom_get_lha(double lst, double alpha){
@@ -217,6 +722,139 @@ void astrom_get_altaz(astrom_coords *object, astrom_location *observer,
 }
 
 
+/* Function to fill the visibility grid of n targets over m time steps
+   (jd_start, jd_start + jd_step, ...) at one site.  Outputs are n x m,
+   row-major by target:  alt[i*m + k] in degrees, and optionally (if not
+   NULL) az[] as astrom_get_altaz() and airmass[] (Hardie 1962; 0 when the
+   target is below the horizon).  Target, site & LST trig are each done
+   once, the LST comes from an atime_lst_stepper, and the targets are
+   split across nthreads threads (<= 0 uses all cores), each working
+   through the grid in time blocks.                                     */
+void astrom_altaz_grid(const astrom_coords *targets, int n,
+		       const astrom_location *observer, double jd_start,
+		       double jd_step, int m, double *alt, double *az,
+		       double *airmass, int nthreads){
+  
+  /* Variable Declarations */
+  int k,chunk;
+  double lst;
+  double *lst_trig;
+  astrom_grid_work *work;
+  atime_lst_stepper stepper;
+  
+  /* Sidereal time at every step, from the LST stepper */
+  lst_trig = (double *)malloc(2 * ((size_t)m + 1) * sizeof(double));
+  atime_lst_stepper_init(&stepper, observer->lon, jd_start, jd_step);
+  for(k=0; k<m; k++){
+    lst = atime_lst_stepper_next(&stepper) * DEG2RAD;
+    lst_trig[k]   = cos(lst);
+    lst_trig[m+k] = sin(lst);
+  }
+  
+  /* One contiguous range of targets per thread */
+  nthreads = parallel_nthreads(nthreads);
+  if(nthreads > n)
+    nthreads = (n > 0) ? n : 1;
+  chunk = (n + nthreads - 1) / nthreads;
+  
+  work = (astrom_grid_work *)malloc(nthreads * sizeof(astrom_grid_work));
+  for(k=0; k<nthreads; k++){
+    work[k].targets = targets;
+    work[k].sin_phi = sin(observer->lat * DEG2RAD);
+    work[k].cos_phi = cos(observer->lat * DEG2RAD);
+    work[k].cos_lst = lst_trig;
+    work[k].sin_lst = lst_trig + m;
+    work[k].m       = m;
+    work[k].first   = k * chunk;
+    work[k].last    = ((k + 1) * chunk < n) ? (k + 1) * chunk : n;
+    work[k].alt     = alt;
+    work[k].az      = az;
+    work[k].airmass = airmass;
+  }
+  
+  parallel_run(nthreads, astrom_grid_worker, work, sizeof(astrom_grid_work));
+  
+  free(work);
+  free(lst_trig);
+  
+  return;
+}
+
+
+/* Thread worker for astrom_altaz_grid():  targets first .. last-1 */
+static void *astrom_grid_worker(void *arg){
+  
+  /* Variable Declarations */
+  int i,j,k,k0,nb,nt;
+  double ca,sa,sd,cd,td,cos_H,sin_H,secz;
+  double sin_alt[ASTROM_BLOCK];
+  double *row,*trig;
+  astrom_grid_work *w = (astrom_grid_work *)arg;
+  
+  /* RA & Dec trig of each target, once for all time blocks */
+  nt   = w->last - w->first;
+  trig = (double *)malloc(4 * ((size_t)nt + 1) * sizeof(double));
+  for(j=0; j<nt; j++){
+    trig[4*j]   = cos(w->targets[w->first+j].ra  * DEG2RAD);
+    trig[4*j+1] = sin(w->targets[w->first+j].ra  * DEG2RAD);
+    trig[4*j+2] = sin(w->targets[w->first+j].dec * DEG2RAD);
+    trig[4*j+3] = cos(w->targets[w->first+j].dec * DEG2RAD);
+  }
+  
+  /* Block over time so the LST trig stays in cache across targets */
+  for(k0=0; k0<w->m; k0+=ASTROM_BLOCK){
+    nb = (w->m - k0 < ASTROM_BLOCK) ? w->m - k0 : ASTROM_BLOCK;
+    
+    for(i=w->first; i<w->last; i++){
+      j  = i - w->first;
+      ca = trig[4*j];
+      sa = trig[4*j+1];
+      sd = trig[4*j+2];
+      cd = trig[4*j+3];
+      
+      // Altitude (Eq. 13.6), with cos H from the angle-sum identity;
+      // sin(alt) is kept for the airmass
+      row = w->alt + (size_t)i * w->m + k0;
+      for(k=0; k<nb; k++){
+	cos_H      = w->cos_lst[k0+k] * ca + w->sin_lst[k0+k] * sa;
+	sin_alt[k] = w->sin_phi * sd + w->cos_phi * cd * cos_H;
+	row[k]     = asin(sin_alt[k]) * RAD2DEG;
+      }
+      
+      // Azimuth (Eq. 13.5), measured as astrom_get_altaz()
+      if(w->az != NULL){
+	td  = sd / cd;
+	row = w->az + (size_t)i * w->m + k0;
+	for(k=0; k<nb; k++){
+	  cos_H  = w->cos_lst[k0+k] * ca + w->sin_lst[k0+k] * sa;
+	  sin_H  = w->sin_lst[k0+k] * ca - w->cos_lst[k0+k] * sa;
+	  row[k] = 180. + atan2(sin_H, cos_H * w->sin_phi - td * w->cos_phi)
+	    * RAD2DEG;
+	}
+      }
+      
+      // Airmass from the sin(alt) of this block
+      if(w->airmass != NULL){
+	row = w->airmass + (size_t)i * w->m + k0;
+	for(k=0; k<nb; k++){
+	  if(sin_alt[k] <= 0.){
+	    row[k] = 0.;
+	    continue;
+	  }
+	  secz   = 1. / sin_alt[k] - 1.;
+	  row[k] = secz + 1. - 0.0018167 * secz - 0.002875 * secz * secz -
+	    0.0008083 * secz * secz * secz;
+	}
+      }
+    }
+  }
+  
+  free(trig);
+  
+  return NULL;
+}
+
+
 /* Function to calculate the transit time of an object on the JD */
 astrom_rst *astrom_get_rst(astrom_coords *object, astrom_location *observer,
 			   double JD, double alt, int *updown){
@@ -281,12 +919,241 @@ astrom_rst *astrom_get_rst(astrom_coords *object, astrom_location *observer,
   return times;
 }
 
+/* Function to calculate rise/transit/set day fractions for n objects at
+   one site on the JD (0h UT), as astrom_get_rst() but into caller-owned
+   arrays:  times[n] and updown[n] (1 always up, -1 never up, 0 rises and
+   sets).  The sidereal time at 0h & the site trig are evaluated once for
+   the whole array, and nothing is allocated.  If refine > 0, that many
+   rounds of the Meeus (Ch 15) corrections are applied to each m:
+      transit:    dm = -H / 360
+      rise/set:   dm = (h - h0) / (360 cos(dec) cos(phi) sin H)          */
+void astrom_get_rst_batch(const astrom_coords *objects, int n,
+			  const astrom_location *observer, double JD,
+			  double alt, int refine, astrom_rst *times,
+			  int *updown){
+  
+  /* Variable Declarations */
+  int i;
+  double theta0,sin_phi,cos_phi;
+  
+  /* Greenwich sidereal time at 0h, and the site latitude trig */
+  theta0  = atime_lst(0., JD);
+  sin_phi = sin(observer->lat * DEG2RAD);
+  cos_phi = cos(observer->lat * DEG2RAD);
+  
+  for(i=0; i<n; i++)
+    astrom_rst_one(&objects[i], sin_phi, cos_phi, observer->lon, theta0,
+		   alt, refine, &times[i], &updown[i]);
+  
+  return;
+}
+
+
+/* Function to calculate rise/transit/set day fractions for n objects over
+   ndays consecutive dates starting at jd_start (0h UT), as
+   astrom_get_rst_batch().  times[] & updown[] are n x ndays, row-major by
+   object:  entry i*ndays + d is object i on date d.                    */
+void astrom_get_rst_range(const astrom_coords *objects, int n,
+			  const astrom_location *observer, double jd_start,
+			  int ndays, double alt, int refine, astrom_rst *times,
+			  int *updown){
+  
+  /* Variable Declarations */
+  int i,d;
+  double theta0,sin_phi,cos_phi;
+  
+  sin_phi = sin(observer->lat * DEG2RAD);
+  cos_phi = cos(observer->lat * DEG2RAD);
+  
+  /* One sidereal time evaluation per date, shared by all objects */
+  for(d=0; d<ndays; d++){
+    theta0 = atime_lst(0., jd_start + d);
+    for(i=0; i<n; i++)
+      astrom_rst_one(&objects[i], sin_phi, cos_phi, observer->lon, theta0,
+		     alt, refine, &times[(size_t)i * ndays + d],
+		     &updown[(size_t)i * ndays + d]);
+  }
+  
+  return;
+}
+
+
+/* Function for preparing an observer site for the fast (_site) routines:
+   caches the latitude trig, the sidereal time at 0h UT of the date
+   holding jd, a linear JD --> LST model anchored at jd, and refraction
+   constants for standard conditions (1010 mbar, 10 C).  Re-prepare for
+   each night; the linear model drifts well under a milliarcsecond over
+   a day.                                                               */
+void astrom_site_prepare(astrom_site *site, const astrom_location *observer,
+			 double jd){
+  
+  site->loc     = *observer;
+  site->sin_lat = sin(observer->lat * DEG2RAD);
+  site->cos_lat = cos(observer->lat * DEG2RAD);
+  
+  /* Sidereal time at 0h UT, and the anchor of the LST model */
+  site->jd_0h      = floor(jd - 0.5) + 0.5;
+  site->theta0     = atime_lst(0., site->jd_0h);
+  site->jd_anchor  = jd;
+  site->lst_anchor = atime_lst(observer->lon, jd);
+  site->lst_rate   = 360.98564736629;
+  
+  astrom_site_weather(site, 1010., 10.);
+  
+  return;
+}
+
+
+/* Function to set the pressure (mbar) & temperature (C) used for the
+   refraction correction of a prepared site */
+void astrom_site_weather(astrom_site *site, double pressure, double temp){
+  
+  site->refr_scale = (pressure / 1010.) * (283. / (273. + temp));
+  
+  return;
+}
+
+
+/* Function that returns the LST (degrees) at jd from the site model */
+double astrom_site_lst(const astrom_site *site, double jd){
+  
+  /* Variable Declarations */
+  double lst;
+  
+  lst  = site->lst_anchor + site->lst_rate * (jd - site->jd_anchor);
+  lst -= 360. * floor(lst / 360.);
+  
+  return lst;
+}
+
+
+/* Function that returns the atmospheric refraction (degrees, to be added
+   to the true altitude) at true altitude alt, for the site's weather.
+   Saemundsson's formula (Meeus, Eq. 16.4):
+      R = 1.02 / tan(h + 10.3 / (h + 5.11))   arcminutes                */
+double astrom_site_refraction(const astrom_site *site, double alt){
+  
+  if(alt < -1.)
+    return 0.;
+  
+  return site->refr_scale * 1.02 /
+    tan((alt + 10.3 / (alt + 5.11)) * DEG2RAD) / 60.;
+}
+
+
+/* Function to calculate the altitude & azimuth of a sky position at jd
+   from a prepared site, as astrom_get_altaz() but with the site trig
+   and sidereal time taken from the site model                          */
+void astrom_get_altaz_site(const astrom_coords *object,
+			   const astrom_site *site, astrom_altaz *position,
+			   double jd){
+  
+  /* Variable Declarations */
+  double H,sin_H,cos_H,sin_delta,cos_delta;
+  
+  H         = (astrom_site_lst(site, jd) - object->ra) * DEG2RAD;
+  sin_H     = sin(H);
+  cos_H     = cos(H);
+  sin_delta = sin(object->dec * DEG2RAD);
+  cos_delta = cos(object->dec * DEG2RAD);
+  
+  /* Calculate alt & az, converting back to degrees */
+  position->az  = 180. + atan2(sin_H, cos_H * site->sin_lat -
+			       sin_delta / cos_delta * site->cos_lat) * RAD2DEG;
+  position->alt = asin(site->sin_lat * sin_delta +
+		       site->cos_lat * cos_delta * cos_H) * RAD2DEG;
+  
+  return;
+}
+
+
+/* Function to calculate rise/transit/set day fractions of an object on
+   the date of a prepared site, as astrom_get_rst_batch() for one object */
+void astrom_get_rst_site(const astrom_coords *object, const astrom_site *site,
+			 double alt, int refine, astrom_rst *times,
+			 int *updown){
+  
+  astrom_rst_one(object, site->sin_lat, site->cos_lat, site->loc.lon,
+		 site->theta0, alt, refine, times, updown);
+  
+  return;
+}
+
+
+/* Function to calculate rise/transit/set for one object, given the site
+   latitude trig, longitude L (+WEST) and the sidereal time at 0h UT */
+static void astrom_rst_one(const astrom_coords *object, double sin_phi,
+			   double cos_phi, double L, double theta0,
+			   double alt, int refine, astrom_rst *times,
+			   int *updown){
+  
+  /* Variable Declarations */
+  int k;
+  double cos_H0,H0,sin_delta,cos_delta,sin_h0;
+  double m[3],theta,H,h;
+  
+  sin_delta = sin(object->dec * DEG2RAD);
+  cos_delta = cos(object->dec * DEG2RAD);
+  sin_h0    = sin(alt * DEG2RAD);
+  
+  /* Calculate Ho */
+  cos_H0 = (sin_h0 - sin_phi * sin_delta) / (cos_phi * cos_delta);
+  
+  /* Transit, Eq. 15.2, in range [0,1] */
+  m[0] = (object->ra + L - theta0) / 360.;
+  m[0] -= floor(m[0]);
+  
+  // Circumpolar:  always above (cos_H0 < -1) or always below (> 1)
+  if(cos_H0 < -1. || cos_H0 > 1.){
+    *updown   = (cos_H0 < -1.) ? 1 : -1;
+    times->m0 = (*updown == 1) ? m[0] : 0.;
+    times->m1 = 0.;
+    times->m2 = 0.;
+    return;
+  }
+  *updown = 0;
+  
+  H0   = acos(cos_H0) * RAD2DEG;
+  m[1] = m[0] - H0 / 360.;
+  m[2] = m[0] + H0 / 360.;
+  m[1] -= floor(m[1]);
+  m[2] -= floor(m[2]);
+  
+  /* Corrections, Meeus Ch 15 -- the object's coordinates are fixed */
+  for(; refine > 0; refine--){
+    for(k=0; k<3; k++){
+      theta = theta0 + 360.985647 * m[k];
+      H     = theta - L - object->ra;
+      H    -= 360. * floor((H + 180.) / 360.);     // To [-180,180)
+      
+      if(k == 0)
+	m[k] -= H / 360.;
+      else{
+	h = asin(sin_phi * sin_delta + cos_phi * cos_delta *
+		 cos(H * DEG2RAD)) * RAD2DEG;
+	m[k] += (h - alt) / (360. * cos_delta * cos_phi * sin(H * DEG2RAD));
+      }
+    }
+  }
+  
+  /* m's should be in range [0,1] */
+  for(k=0; k<3; k++)
+    m[k] -= floor(m[k]);
+  
+  times->m0 = m[0];
+  times->m1 = m[1];
+  times->m2 = m[2];
+  
+  return;
+}
+
+
 /* Function for reading in observatory location catalog files */
 astrom_location *astrom_read_observatories(char *filename, int *n){
   
   /* Variable Declarations */
   int i;
-  char line[211],lat_str[50],lon_str[50],tz_str[15],num_str[15];
+  char line[211];
   FILE *fp;
   astrom_location *locations,catline;
   
@@ -297,43 +1164,310 @@ astrom_location *astrom_read_observatories(char *filename, int *n){
   /* Allocate space for the structure array */
   locations = (astrom_location *)malloc(*n * sizeof(astrom_location)); 
   
-  /* FOR loop reading in the lines of the catalog file */
-  for(i=0; i<*n; i++){
-
-    // Get the line first, check for '#'. then read in 8 fields
-    fgets(line,210,fp);
+  /* Read the lines of the catalog file, keeping only those that parse */
+  i = 0;
+  while(i < *n && fgets(line,210,fp) != NULL){
     if(line[0] == '#')      // Ignore commented lines
-      i--;
-    else{                   // If not commented, read in line
-      // Catalog is character-wise laid out
+      continue;
+    if(astrom_parse_observatory(line, strlen(line), &catline))
+      locations[i++] = catline;
+  }
+  *n = i;                   // Blank or rejected lines are not counted
+  
+  fclose(fp);
+  
+  return locations;
+}
 
-      // 5 characters for the location number
-      strncpy(num_str,line,5);
-      catline.num = atoi(num_str);
 
-      // 40 characters for the location name
-      strncpy(catline.name,line+5,40);
-      catline.name[40] = '\0';          // Append null character
+/* Function for reading an observatory location catalog with its lines
+   split across nthreads threads (<= 0 uses all cores).  Same sites, in
+   the same order, as astrom_read_observatories().                    */
+astrom_location *astrom_read_observatories_parallel(char *filename, int *n,
+						    int nthreads){
+  
+  return (astrom_location *)parallel_parse_file(filename,
+						sizeof(astrom_location),
+						astrom_observatory_line,
+						nthreads, n);
+}
 
-      // 15 characters for the location latitude
-      strncpy(lat_str,line+45,15);
-      catline.lat = atof(lat_str);
 
-      // 15 characters for the location longitude
-      strncpy(lon_str,line+60,15);
-      catline.lon = atof(lon_str);
+/* Function for parsing one line (len characters, need not be terminated)
+   of an observatory location catalog into site.  Returns 1 if a site was
+   read, 0 for comment ('#') and blank lines.                           */
+int astrom_parse_observatory(const char *line, size_t len,
+			     astrom_location *site){
+  
+  /* Variable Declarations */
+  char field[41];
+  
+  if(len == 0 || line[0] == '#' || line[0] == '\n')
+    return 0;
+  
+  // Catalog is character-wise laid out
 
-      // 5 characters for the location time zone
-      strncpy(tz_str,line+75,5);
-      catline.tz = atoi(tz_str);
+  // 5 characters for the location number
+  astrom_field(field, line, len, 0, 5);
+  site->num = atoi(field);
 
-      locations[i] = catline;
-    }
+  // 40 characters for the location name
+  astrom_field(site->name, line, len, 5, 40);
+
+  // 15 characters for the location latitude
+  astrom_field(field, line, len, 45, 15);
+  site->lat = atof(field);
+
+  // 15 characters for the location longitude
+  astrom_field(field, line, len, 60, 15);
+  site->lon = atof(field);
+
+  // 5 characters for the location time zone
+  astrom_field(field, line, len, 75, 5);
+  site->tz = atoi(field);
+  
+  return 1;
+}
+
+
+/* Line parser adapter for parallel_parse_file() */
+static int astrom_observatory_line(const char *line, size_t len, void *rec){
+  return astrom_parse_observatory(line, len, (astrom_location *)rec);
+}
+
+
+/* Function to copy the fixed-width field [start, start+width) of a line
+   of length len into dst, null-terminated; short lines give short (or
+   empty) fields, and a newline ends the line.                          */
+static void astrom_field(char *dst, const char *line, size_t len, int start,
+			 int width){
+  
+  /* Variable Declarations */
+  int i;
+  
+  for(i=0; i<width && (size_t)(start + i) < len; i++){
+    if(line[start+i] == '\n' || line[start+i] == '\0')
+      break;
+    dst[i] = line[start+i];
   }
+  dst[i] = '\0';
+  
+  return;
+}
+
+
+/* Function for loading an observatory catalog into a registry, reading the
+   file once, and indexing the sites by number and by name (case-blind,
+   trailing blanks ignored) in open-addressed hash tables.  Free with
+   astrom_registry_free().                                              */
+astrom_registry *astrom_registry_load(char *filename){
+  
+  /* Variable Declarations */
+  int i,size=0;
+  char line[211];
+  unsigned int h;
+  FILE *fp;
+  astrom_registry *reg;
+  astrom_location site;
+  
+  reg = (astrom_registry *)malloc(sizeof(astrom_registry));
+  reg->n     = 0;
+  reg->sites = NULL;
   
+  /* Single pass, growing the site array as needed */
+  fp = fileopenr(filename);
+  while(fgets(line, 210, fp) != NULL){
+    if(!astrom_parse_observatory(line, strlen(line), &site))
+      continue;
+    
+    // Trim the blank padding from the name
+    i = strlen(site.name);
+    while(i > 0 && (site.name[i-1] == ' ' || site.name[i-1] == '\t'))
+      site.name[--i] = '\0';
+    
+    if(reg->n == size){
+      size = (size) ? 2 * size : 64;
+      reg->sites = (astrom_location *)realloc(reg->sites, size *
+					      sizeof(astrom_location));
+    }
+    reg->sites[reg->n++] = site;
+  }
   fclose(fp);
   
-  return locations;
+  /* Hash tables at no more than half full, power-of-two sized */
+  reg->nbuckets = 16;
+  while(reg->nbuckets < 2 * reg->n)
+    reg->nbuckets *= 2;
+  reg->by_num  = (int *)malloc(2 * reg->nbuckets * sizeof(int));
+  reg->by_name = reg->by_num + reg->nbuckets;
+  for(i=0; i<2*reg->nbuckets; i++)
+    reg->by_num[i] = -1;
+  
+  /* Insert, linear probing; the first of any duplicates wins */
+  for(i=0; i<reg->n; i++){
+    h = astrom_hash_num(reg->sites[i].num) & (reg->nbuckets - 1);
+    while(reg->by_num[h] >= 0 &&
+	  reg->sites[reg->by_num[h]].num != reg->sites[i].num)
+      h = (h + 1) & (reg->nbuckets - 1);
+    if(reg->by_num[h] < 0)
+      reg->by_num[h] = i;
+    
+    h = astrom_hash_name(reg->sites[i].name) & (reg->nbuckets - 1);
+    while(reg->by_name[h] >= 0 &&
+	  astrom_name_cmp(reg->sites[reg->by_name[h]].name,
+			  reg->sites[i].name))
+      h = (h + 1) & (reg->nbuckets - 1);
+    if(reg->by_name[h] < 0)
+      reg->by_name[h] = i;
+  }
+  
+  return reg;
+}
+
+
+/* Function to free the memory associated with a registry */
+void astrom_registry_free(astrom_registry *reg){
+  
+  if(reg == NULL)
+    return;
+  
+  free(reg->sites);
+  free(reg->by_num);
+  free(reg);
+  
+  return;
+}
+
+
+/* Function that returns the registry for filename, loading it only the
+   first time it is asked for.  Every registry loaded is kept for the
+   life of the process (do not free them); safe to call from several
+   threads.                                                              */
+const astrom_registry *astrom_registry_get(char *filename){
+  
+  /* Variable Declarations */
+  int i;
+  const astrom_registry *reg = NULL;
+  static char **names = NULL;
+  static astrom_registry **cache = NULL;
+  static int ncache = 0, nalloc = 0;
+  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  
+  pthread_mutex_lock(&lock);
+  for(i=0; i<ncache && reg == NULL; i++)
+    if(!strcmp(names[i], filename))
+      reg = cache[i];
+  
+  // First request for this file -- load it and add it to the list
+  if(reg == NULL){
+    if(ncache == nalloc){
+      nalloc = (nalloc) ? 2*nalloc : ASTROM_REGISTRY_BLOCK;
+      names = (char **)realloc(names, nalloc * sizeof(char *));
+      cache = (astrom_registry **)realloc(cache, nalloc *
+					  sizeof(astrom_registry *));
+    }
+    names[ncache] = (char *)malloc(strlen(filename) + 1);
+    strcpy(names[ncache], filename);
+    reg = cache[ncache++] = astrom_registry_load(filename);
+  }
+  pthread_mutex_unlock(&lock);
+  
+  return reg;
+}
+
+
+/* Function for looking up a site by catalog number; NULL if not found */
+const astrom_location *astrom_registry_find_num(const astrom_registry *reg,
+						int num){
+  
+  /* Variable Declarations */
+  unsigned int h;
+  
+  h = astrom_hash_num(num) & (reg->nbuckets - 1);
+  while(reg->by_num[h] >= 0){
+    if(reg->sites[reg->by_num[h]].num == num)
+      return &reg->sites[reg->by_num[h]];
+    h = (h + 1) & (reg->nbuckets - 1);
+  }
+  
+  return NULL;
+}
+
+
+/* Function for looking up a site by name, ignoring case and trailing
+   blanks; NULL if not found */
+const astrom_location *astrom_registry_find_name(const astrom_registry *reg,
+						 const char *name){
+  
+  /* Variable Declarations */
+  unsigned int h;
+  
+  h = astrom_hash_name(name) & (reg->nbuckets - 1);
+  while(reg->by_name[h] >= 0){
+    if(!astrom_name_cmp(reg->sites[reg->by_name[h]].name, name))
+      return &reg->sites[reg->by_name[h]];
+    h = (h + 1) & (reg->nbuckets - 1);
+  }
+  
+  return NULL;
+}
+
+
+/* Hash of a site number (integer finalizer from MurmurHash3) */
+static unsigned int astrom_hash_num(int num){
+  
+  unsigned int h = (unsigned int)num;
+  
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35U;
+  h ^= h >> 16;
+  
+  return h;
+}
+
+
+/* Hash of a site name:  FNV-1a over the lower-cased characters, with
+   trailing blanks dropped */
+static unsigned int astrom_hash_name(const char *name){
+  
+  /* Variable Declarations */
+  int i,len;
+  unsigned int h = 2166136261U;
+  
+  len = strlen(name);
+  while(len > 0 && (name[len-1] == ' ' || name[len-1] == '\t' ||
+		    name[len-1] == '\n'))
+    len--;
+  
+  for(i=0; i<len; i++){
+    h ^= (unsigned char)tolower((unsigned char)name[i]);
+    h *= 16777619U;
+  }
+  
+  return h;
+}
+
+
+/* Function to compare site names as the hash sees them -- case-blind,
+   trailing blanks dropped.  Returns 0 if equal. */
+static int astrom_name_cmp(const char *a, const char *b){
+  
+  /* Variable Declarations */
+  int la,lb;
+  
+  la = strlen(a);
+  while(la > 0 && (a[la-1] == ' ' || a[la-1] == '\t' || a[la-1] == '\n'))
+    la--;
+  lb = strlen(b);
+  while(lb > 0 && (b[lb-1] == ' ' || b[lb-1] == '\t' || b[lb-1] == '\n'))
+    lb--;
+  
+  if(la != lb)
+    return 1;
+  
+  return strncasecmp(a, b, la);
 }
 
 
@@ -342,15 +1476,15 @@ astrom_location *astrom_read_observatories(char *filename, int *n){
 astrom_location astrom_get_location(char *filename){
   
   /* Variable Declarations */
-  int locno,good_obj,j,num_loc;
-  astrom_location *list;
+  int locno,good_obj,j;
+  const astrom_registry *list;
   
-  /* Read in telescope DAT file */
-  list = astrom_read_observatories(filename, &num_loc);
+  /* Telescope DAT file, parsed only on the first call */
+  list = astrom_registry_get(filename);
   
   printf("\nTelescope locations:\n--------------------\n");
-  for(j=0;j<num_loc;j++)
-    printf("%d    %s\n",j+1,list[j].name);
+  for(j=0;j<list->n;j++)
+    printf("%d    %s\n",j+1,list->sites[j].name);
   
   // Select site number, w/ error checking
   do{
@@ -359,12 +1493,12 @@ astrom_location astrom_get_location(char *filename){
     fscanf(stdin,"%d",&locno);
     
     // Error checking
-    if(locno < 1 || locno > num_loc){
+    if(locno < 1 || locno > list->n){
       printf("Improper location number.  Try again.\n");
       good_obj = 0;
     }else good_obj = 1;
   }while(!good_obj);
   
-  return list[locno-1];
+  return list->sites[locno-1];
   
 }
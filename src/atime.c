@@ -17,45 +17,23 @@
 
 #include <tpeb.h>
 
+// Two-digit fields for the date parser
+#define ATIME_DIGITS2(p) ((p)[0] >= '0' && (p)[0] <= '9' && \
+			  (p)[1] >= '0' && (p)[1] <= '9')
+#define ATIME_VAL2(p)    (10 * ((p)[0] - '0') + ((p)[1] - '0'))
+
+static void atime_context_sidereal(atime_context *ctx);
+static void atime_put_int(char *p, long long val, int width);
+
 
 /* Function that returns the current date/time in an atime_time structure */
 atime_time *atime_get_date_now(int clock_type){
   
   /* Variable Declarations */
   atime_time *date;
-  char buf0[81],buf1[81],buf2[81],buf3[81],buf4[81],buf5[81],buf6[81];
-  time_t now;
-  struct tm *ptr;
-  struct timeval tv;
-  
   
   date = (atime_time *)malloc(sizeof(atime_time));
-  
-  /* Get time string */
-  time(&now);
-  if(clock_type == ATIME_LOCAL)
-    ptr = localtime(&now);  
-  else if(clock_type == ATIME_GMT)
-    ptr = gmtime(&now);  
-  gettimeofday(&tv, NULL); 
-  
-  /* Extract ascii information from the date */
-  /* And convert it to numbers */
-  
-  strftime(buf0, 80, "%S", ptr);
-  date->sec   = atof(buf0) + (float)tv.tv_usec/1000000.;
-  strftime(buf1, 80, "%M", ptr);
-  date->min   = atoi(buf1);
-  strftime(buf2, 80, "%H", ptr);
-  date->hour  = atoi(buf2);
-  strftime(buf3, 80, "%d", ptr);
-  date->day   = atoi(buf3);
-  strftime(buf5, 80, "%m", ptr);
-  date->month = atoi(buf5);
-  strftime(buf4, 80, "%Y", ptr);
-  date->year  = atoi(buf4);
-  strftime(buf6, 80, "%j", ptr);
-  date->doy   = atoi(buf6);
+  atime_clock(clock_type, date);
   
   return date;
 }
@@ -65,48 +43,108 @@ atime_time *atime_get_date(int clock_type, int prevday){
   
   /* Variable Declarations */
   atime_time *date;
-  char buf0[81],buf1[81],buf2[81],buf3[81],buf4[81],buf5[81],buf6[81];
-  time_t now;
-  struct tm *ptr;
-  struct timeval tv;
-  
+  struct timespec ts;
   
   date = (atime_time *)malloc(sizeof(atime_time));
   
   /* Get # of seconds since Jan. 1, 1970 */
-  time(&now);
+  clock_gettime(CLOCK_REALTIME, &ts);
   
   /* Remove the appropriate number of days from now */
-  now -= (86400 * prevday);
-  
-  /* Get time string */
-  if(clock_type == ATIME_LOCAL)
-    ptr = localtime(&now);  
-  else if(clock_type == ATIME_GMT)
-    ptr = gmtime(&now);  
-  gettimeofday(&tv, NULL); 
-  
-  /* Extract ascii information from the date */
-  /* And convert it to numbers */
-  
-  strftime(buf0, 80, "%S", ptr);
-  date->sec   = atof(buf0) + (float)tv.tv_usec/1000000.;
-  strftime(buf1, 80, "%M", ptr);
-  date->min   = atoi(buf1);
-  strftime(buf2, 80, "%H", ptr);
-  date->hour  = atoi(buf2);
-  strftime(buf3, 80, "%d", ptr);
-  date->day   = atoi(buf3);
-  strftime(buf5, 80, "%m", ptr);
-  date->month = atoi(buf5);
-  strftime(buf4, 80, "%Y", ptr);
-  date->year  = atoi(buf4);
-  strftime(buf6, 80, "%j", ptr);
-  date->doy   = atoi(buf6);
+  ts.tv_sec -= (86400 * (time_t)prevday);
+  
+  atime_fill(ts.tv_sec, ts.tv_nsec, clock_type, date);
+  
+  return date;
+}
+
+
+/* Function that fills a caller-owned atime_time with the current date/time
+   (ATIME_GMT or ATIME_LOCAL), with one clock_gettime() call, no allocation
+   and no string formatting.  Returns 0, or -1 if the clock read fails. */
+int atime_clock(int clock_type, atime_time *date){
+  
+  /* Variable Declarations */
+  struct timespec ts;
+  
+  if(clock_gettime(CLOCK_REALTIME, &ts) != 0)
+    return -1;
+  
+  atime_fill(ts.tv_sec, ts.tv_nsec, clock_type, date);
+  
+  return 0;
+}
+
+
+/* Function that returns the current date/time by value, as atime_clock() */
+atime_time atime_now(int clock_type){
+  
+  /* Variable Declarations */
+  atime_time date;
+  
+  atime_clock(clock_type, &date);
   
   return date;
 }
 
+
+/* Function to break seconds (+ nanoseconds) since Jan. 1, 1970 down into an
+   atime_time.  GMT is done with integer arithmetic on the day count (the
+   civil-from-days algorithm of H. Hinnant), local time with localtime_r().
+   Both are reentrant.                                                  */
+void atime_fill(time_t secs, long nsec, int clock_type, atime_time *date){
+  
+  /* Variable Declarations */
+  long days,rem,era,doe,yoe,doy,mp;
+  int year;
+  struct tm tm_local;
+  static const int cumdays[12] = {0,31,59,90,120,151,181,212,243,273,304,334};
+  
+  if(clock_type == ATIME_LOCAL){
+    localtime_r(&secs, &tm_local);
+    date->year  = tm_local.tm_year + 1900;
+    date->month = tm_local.tm_mon + 1;
+    date->day   = tm_local.tm_mday;
+    date->doy   = tm_local.tm_yday + 1;
+    date->hour  = tm_local.tm_hour;
+    date->min   = tm_local.tm_min;
+    date->sec   = tm_local.tm_sec + nsec / 1.e9;
+    return;
+  }
+  
+  /* Split into whole days & seconds of the day */
+  days = (long)(secs / 86400);
+  rem  = (long)(secs % 86400);
+  if(rem < 0){
+    rem += 86400;
+    days--;
+  }
+  date->hour = rem / 3600;
+  date->min  = (rem % 3600) / 60;
+  date->sec  = (rem % 60) + nsec / 1.e9;
+  
+  /* Days since 1970-01-01 to year, month, day (March-based years) */
+  days += 719468;
+  era  = (days >= 0 ? days : days - 146096) / 146097;
+  doe  = days - era * 146097;
+  yoe  = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+  doy  = doe - (365*yoe + yoe/4 - yoe/100);
+  mp   = (5*doy + 2) / 153;
+  
+  date->day   = doy - (153*mp + 2)/5 + 1;
+  date->month = (mp < 10) ? mp + 3 : mp - 9;
+  year        = yoe + era * 400 + (date->month <= 2);
+  date->year  = year;
+  
+  /* Day of the year, January 1 = 1 */
+  date->doy = cumdays[date->month - 1] + date->day;
+  if(date->month > 2 &&
+     ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0))
+    date->doy++;
+  
+  return;
+}
+
 /* Function that calculates JD based on year, month, day */
 double atime_jd(int year, int month, double day){
   
@@ -132,71 +170,163 @@ double atime_jd(int year, int month, double day){
 /* Function that returns today's JD (at 0h GMT) */
 double atime_jd_today(){
   
-  atime_time *now;
-  double jd;
+  atime_context ctx;
+  
+  atime_context_now(&ctx);
+  
+  return ctx.jd_0h;
+}
+
 
-  /* Get time structure */
-  now = atime_get_date_now(ATIME_GMT);
+/* Function that returns the JD of the moment */
+double atime_jd_now(){
   
-  // Use atime_jd() to calculate the day's JD
-  jd = atime_jd(now->year, now->month, now->day);
+  atime_context ctx;
   
-  // Fix memory leak by freeing atime_time structure.
-  free(now);
+  atime_context_now(&ctx);
   
-  return jd;
+  return ctx.jd;
 }
 
 
-/* Function that returns the JD of the moment (er, nearest second */
-double atime_jd_now(){
+/* Function to calculate the LST, based on current location and time
+   The LST is in ddd.dddddd (i.e. degrees past midnight) */
+double atime_get_lst(double longitude){
   
-  atime_time *now;
-  double daypart,jd_now;
+  atime_context ctx;
   
-  /* Get time structure */
-  now = atime_get_date_now(ATIME_GMT);
+  /* One snapshot of the clock for JD, JD @0h & T alike */
+  atime_context_now(&ctx);
   
-  daypart = (now->hour / 24.) + (now->min / 1440.) + (now->sec / 86400.);
+  return atime_lst_ctx(&ctx, longitude);
+}
+
+
+/* Function that captures the current instant (one clock read) into a time
+   context, deriving the GMT date, JD, JD at 0h GMT, T and the Greenwich
+   sidereal time from that single reading.  Returns 0, or -1 if the clock
+   read fails.                                                          */
+int atime_context_now(atime_context *ctx){
+  
+  /* Variable Declarations */
+  long days,rem;
+  struct timespec ts;
   
-  jd_now = atime_jd_today() + daypart;
+  if(clock_gettime(CLOCK_REALTIME, &ts) != 0)
+    return -1;
   
-  // Fix memory leak by freeing atime_time structure.
-  free(now);
+  atime_fill(ts.tv_sec, ts.tv_nsec, ATIME_GMT, &ctx->date);
   
-  return jd_now;
+  /* JD of the Unix epoch is 2440587.5 */
+  days = (long)(ts.tv_sec / 86400);
+  rem  = (long)(ts.tv_sec % 86400);
+  if(rem < 0){
+    rem += 86400;
+    days--;
+  }
+  ctx->jd_0h = 2440587.5 + days;
+  ctx->jd    = ctx->jd_0h + (rem + ts.tv_nsec / 1.e9) / 86400.;
+  
+  atime_context_sidereal(ctx);
+  
+  return 0;
 }
 
 
-/* Function to calculate the LST, based on current location and time
-   The LST is in ddd.dddddd (i.e. degrees past midnight) */
-double atime_get_lst(double longitude){
+/* Function that sets a time context to the instant jd */
+void atime_context_at(atime_context *ctx, double jd){
+  
+  ctx->jd    = jd;
+  ctx->jd_0h = floor(jd - 0.5) + 0.5;
+  atime_jd_to_date(jd, &ctx->date);
+  
+  atime_context_sidereal(ctx);
+  
+  return;
+}
+
+
+/* Function to calculate the LST (degrees) at a longitude (+WEST) for the
+   instant held in a time context */
+double atime_lst_ctx(const atime_context *ctx, double longitude){
   
   /* Variable Declarations */
-  long double jd,jd_now,T,theta_0,lst;  
+  double lst;
+  
+  /* Calculate LST via theta = theta_0 - longitude, within [0,360) */
+  lst  = ctx->gmst - longitude;
+  lst -= floor(lst / 360.) * 360.;
+  
+  return lst;
+}
+
 
-  /* Get today's JD via atime_jd() */
-  jd     = atime_jd_today();
-  jd_now = atime_jd_now();
+/* Function that converts a JD to the GMT calendar date & time
+   Algorithm from "Astronomical Algorithms, 2nd ed", Ch 7, by Jean Meeus */
+void atime_jd_to_date(double jd, atime_time *date){
+  
+  /* Variable Declarations */
+  long Z,A,B,C,D,E,alpha;
+  double F,secs;
+  int year;
+  static const int cumdays[12] = {0,31,59,90,120,151,181,212,243,273,304,334};
+  
+  jd += 0.5;
+  Z = (long)floor(jd);
+  F = jd - Z;
+  
+  if(Z < 2299161)
+    A = Z;
+  else{
+    alpha = (long)floor((Z - 1867216.25) / 36524.25);
+    A = Z + 1 + alpha - alpha / 4;
+  }
+  B = A + 1524;
+  C = (long)floor((B - 122.1) / 365.25);
+  D = (long)floor(365.25 * C);
+  E = (long)floor((B - D) / 30.6001);
+  
+  date->day   = B - D - (long)floor(30.6001 * E);
+  date->month = (E < 14) ? E - 1 : E - 13;
+  date->year  = (date->month > 2) ? C - 4716 : C - 4715;
+  year        = date->year;
+  
+  /* Time of day from the fraction */
+  secs = F * 86400.;
+  date->hour = (int)(secs / 3600.);
+  date->min  = (int)((secs - date->hour * 3600.) / 60.);
+  date->sec  = secs - date->hour * 3600. - date->min * 60.;
+  
+  /* Day of the year, January 1 = 1 */
+  date->doy = cumdays[date->month - 1] + date->day;
+  if(date->month > 2 &&
+     ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0 ||
+      (year <= 1582 && year % 4 == 0)))
+    date->doy++;
+  
+  return;
+}
+
+
+/* Function to fill in T & the Greenwich sidereal time of a time context
+   from its jd & jd_0h -- the expression of atime_lst(), but with T taken
+   at the true 0h GMT (jd_0h = floor(jd - 0.5) + 0.5), as in
+   atime_lst_array(); see there for how atime_lst() differs */
+static void atime_context_sidereal(atime_context *ctx){
+  
+  /* Variable Declarations */
+  long double T,theta_0;
   
   /* Calculate T */
-  T = (jd - 2451545.0) / 36525;
-    
-  /* Calculate theta_0 with the aid of atime_jdnow() */
-  theta_0 = 280.46061837 + (360.98564736629 * (jd_now - 2451545.0)) +
+  T = (ctx->jd_0h - 2451545.0) / 36525;
+  
+  theta_0 = 280.46061837 + (360.98564736629 * (ctx->jd - 2451545.0L)) +
     (0.000387933 * T * T) - (T * T * T / 38710000.);
   
-  /* Calculate LST via theta = theta_0 - longitude */
-  lst = theta_0 - longitude;
-
-  // IF lst is outside the range [0,360], adjust until it is
-  if(lst > 360.){
-    lst -= floor(lst / 360.) * 360.;
-  }else if(lst < 0.)
-    while(lst < 0.)
-      lst += 360.;
+  ctx->T    = (double)T;
+  ctx->gmst = (double)(theta_0 - floorl(theta_0 / 360.) * 360.);
   
-  return (double)lst;
+  return;
 }
 
 
@@ -233,6 +363,345 @@ double atime_lst(double longitude, double jd){
 }
 
 
+/* Function to calculate the LST (degrees) at a longitude for n JDs.
+   The whole-day part of (jd - J2000.0) is split off exactly, and its
+   360-degree multiples dropped before any rounding:
+      theta_0 = 280.46061837 + 0.98564736629 * days + 360.98564736629 * frac
+   so double arithmetic keeps (better than) the long double accuracy of
+   atime_lst(), in a branch-free loop the compiler can vectorize.  T is
+   taken at jd_0h = floor(jd - 0.5) + 0.5, 0h GMT of the date containing
+   jd.  atime_lst() differs here for times from 12h to 24h GMT (JD
+   fraction below .5):  its jd_0h comes out as floor(jd) + 1.5 rather
+   than floor(jd) - 0.5, two days late, which moves its T-squared term by
+   about 4e-8 * |T| degree (T in centuries from J2000.0).  From 0h to 12h
+   GMT the two agree.                                                    */
+void atime_lst_array(double longitude, const double *jd, int n, double *lst){
+  
+  /* Variable Declarations */
+  int i;
+  double d,days,frac,T,theta;
+  
+  for(i=0; i<n; i++){
+    d    = jd[i] - 2451545.0;           // Exact for any modern JD
+    days = floor(d);
+    frac = d - days;                    // Also exact
+    T    = (floor(jd[i] - 0.5) + 0.5 - 2451545.0) / 36525.;
+    
+    theta = 280.46061837 + 0.98564736629 * days + 360.98564736629 * frac +
+      (0.000387933 * T * T) - (T * T * T / 38710000.) - longitude;
+    
+    lst[i] = theta - floor(theta / 360.) * 360.;
+  }
+  
+  return;
+}
+
+
+/* Function to calculate JD for n calendar dates given as year, month &
+   (fractional) day columns -- atime_jd() over arrays                   */
+void atime_jd_array(const int *year, const int *month, const double *day,
+		    int n, double *jd){
+  
+  /* Variable Declarations */
+  int i,y,m,A,B;
+  
+  for(i=0; i<n; i++){
+    y = (month[i] < 3) ? year[i] - 1  : year[i];
+    m = (month[i] < 3) ? month[i] + 12 : month[i];
+    
+    A = (int)floor(y / 100.);
+    B = (y > 1582) ? 2 - A + (int)floor(A / 4.) : 0;
+    
+    jd[i] = floor(365.25 * (y + 4716)) + floor(30.6001 * (m + 1)) + day[i] +
+      B - 1524.5;
+  }
+  
+  return;
+}
+
+
+/* Function to start a sidereal time stepper at jd_start, for a uniform
+   grid of jd_step days at a longitude (+WEST).  Each step then costs one
+   addition; the stepper re-anchors on the exact expression every
+   ATIME_LST_REANCHOR steps, which bounds the accumulated round-off.    */
+void atime_lst_stepper_init(atime_lst_stepper *st, double longitude,
+			    double jd_start, double jd_step){
+  
+  st->longitude = longitude;
+  st->jd0       = jd_start;
+  st->step      = jd_step;
+  st->k         = 0;
+  
+  /* Increment per step, within [0,360) */
+  st->dlst = 360.98564736629 * jd_step;
+  st->dlst -= floor(st->dlst / 360.) * 360.;
+  
+  atime_lst_array(longitude, &jd_start, 1, &st->lst);
+  
+  return;
+}
+
+
+/* Function that returns the LST (degrees) at the stepper's current grid
+   point, then advances it one step */
+double atime_lst_stepper_next(atime_lst_stepper *st){
+  
+  /* Variable Declarations */
+  double lst,jd;
+  
+  lst = st->lst;
+  st->k++;
+  
+  if(st->k % ATIME_LST_REANCHOR == 0){
+    jd = st->jd0 + st->k * st->step;
+    atime_lst_array(st->longitude, &jd, 1, &st->lst);
+  }
+  else{
+    st->lst += st->dlst;
+    if(st->lst >= 360.)
+      st->lst -= 360.;
+  }
+  
+  return lst;
+}
+
+
+/* Function to fill lst[] with the next n grid points of a stepper */
+void atime_lst_stepper_fill(atime_lst_stepper *st, double *lst, int n){
+  
+  /* Variable Declarations */
+  int i;
+  
+  for(i=0; i<n; i++)
+    lst[i] = atime_lst_stepper_next(st);
+  
+  return;
+}
+
+
+/* Function for parsing an ISO-8601 / FITS date string (len characters, or
+   up to a null) straight to JD and, if mjd is not NULL, MJD.  Accepted:
+      YYYY-MM-DD[Thh:mm[:ss[.sss...]]][Z]     ('T' or a blank)
+      DD/MM/YY                                 (old FITS form, 19YY)
+   with surrounding blanks or single quotes (as in FITS header values).
+   The MJD is assembled from the whole day & the day fraction separately,
+   so it keeps full precision.  Returns 0, or -1 if the string is not a
+   valid date.  No sscanf(), no allocation.                              */
+int atime_iso_to_jd(const char *str, size_t len, double *jd, double *mjd){
+  
+  /* Variable Declarations */
+  int year,month,day,hour=0,min=0,ndays;
+  long long digits;
+  double sec=0.,scale,day0,frac;
+  const char *p,*end;
+  static const int mdays[13] = {0,31,29,31,30,31,30,31,31,30,31,30,31};
+  
+  /* Trim blanks & quotes */
+  p = str;
+  end = str;
+  while((size_t)(end - str) < len && *end != '\0')
+    end++;
+  while(p < end && (*p == ' ' || *p == '\'' || *p == '\t'))
+    p++;
+  while(end > p && (end[-1] == ' ' || end[-1] == '\'' || end[-1] == '\t' ||
+		    end[-1] == '\n' || end[-1] == 'Z'))
+    end--;
+  
+  /* Old FITS form, DD/MM/YY */
+  if(end - p == 8 && p[2] == '/' && p[5] == '/'){
+    if(!ATIME_DIGITS2(p) || !ATIME_DIGITS2(p+3) || !ATIME_DIGITS2(p+6))
+      return -1;
+    day   = ATIME_VAL2(p);
+    month = ATIME_VAL2(p+3);
+    year  = 1900 + ATIME_VAL2(p+6);
+    p = end;
+  }
+  
+  /* ISO-8601, YYYY-MM-DD... */
+  else{
+    if(end - p < 10 || p[4] != '-' || p[7] != '-' ||
+       !ATIME_DIGITS2(p) || !ATIME_DIGITS2(p+2) || !ATIME_DIGITS2(p+5) ||
+       !ATIME_DIGITS2(p+8))
+      return -1;
+    year  = 100 * ATIME_VAL2(p) + ATIME_VAL2(p+2);
+    month = ATIME_VAL2(p+5);
+    day   = ATIME_VAL2(p+8);
+    p += 10;
+    
+    // Optional time of day
+    if(p < end){
+      if((*p != 'T' && *p != ' ') || end - p < 6 || p[3] != ':' ||
+	 !ATIME_DIGITS2(p+1) || !ATIME_DIGITS2(p+4))
+	return -1;
+      hour = ATIME_VAL2(p+1);
+      min  = ATIME_VAL2(p+4);
+      p += 6;
+      
+      if(p < end){
+	if(end - p < 3 || *p != ':' || !ATIME_DIGITS2(p+1))
+	  return -1;
+	sec = ATIME_VAL2(p+1);
+	p += 3;
+	
+	// Fractional seconds, any number of digits (at least one)
+	if(p < end && *p == '.'){
+	  if(++p == end || *p < '0' || *p > '9')
+	    return -1;
+	  for(digits=0, scale=1.; p < end && *p >= '0' && *p <= '9'; p++){
+	    if(scale < 1.e15){
+	      digits = 10 * digits + (*p - '0');
+	      scale *= 10.;
+	    }
+	  }
+	  sec += digits / scale;
+	}
+      }
+    }
+  }
+  
+  /* Anything left over, or out of range, is an error */
+  if(p != end)
+    return -1;
+  if(month < 1 || month > 12 || day < 1 || day > mdays[month])
+    return -1;
+  ndays = (month == 2 && !((year % 4 == 0 && year % 100 != 0) ||
+			   year % 400 == 0)) ? 28 : mdays[month];
+  if(day > ndays || hour > 23 || min > 59 || sec >= 61.)
+    return -1;
+  
+  day0 = atime_jd(year, month, day);
+  frac = (hour * 3600. + min * 60. + sec) / 86400.;
+  
+  *jd = day0 + frac;
+  if(mjd != NULL)
+    *mjd = (day0 - 2400000.5) + frac;
+  
+  return 0;
+}
+
+
+/* Function for parsing n null-terminated date strings with
+   atime_iso_to_jd().  mjd may be NULL.  Entries that do not parse are
+   set to NAN; returns the number of such entries.                      */
+int atime_iso_to_jd_array(const char **str, int n, double *jd, double *mjd){
+  
+  /* Variable Declarations */
+  int i,nbad=0;
+  double m;
+  
+  for(i=0; i<n; i++){
+    if(atime_iso_to_jd(str[i], (size_t)-1, &jd[i], &m) != 0){
+      jd[i] = m = NAN;
+      nbad++;
+    }
+    if(mjd != NULL)
+      mjd[i] = m;
+  }
+  
+  return nbad;
+}
+
+
+/* Function for writing a JD as an ISO-8601 date string,
+   YYYY-MM-DDThh:mm:ss[.sss], with ndigits (0-9) decimals on the seconds,
+   into buf (buflen bytes).  Rounding is done on the integer count of
+   seconds-units in the day, so it carries through minutes, hours and the
+   date (never "60" seconds).  Years 0000-9999 only.  Returns the length
+   written, or -1 if buf is too small or the date is out of range.       */
+int atime_jd_to_iso(double jd, int ndigits, char *buf, size_t buflen){
+  
+  /* Variable Declarations */
+  int i,len;
+  long long unit,ticks,perday,secs;
+  double Z,F;
+  atime_time date;
+  
+  if(ndigits < 0) ndigits = 0;
+  if(ndigits > 9) ndigits = 9;
+  len = 19 + ((ndigits) ? ndigits + 1 : 0);
+  if(buflen < (size_t)len + 1)
+    return -1;
+  
+  /* Four-digit years only (JD 1721057.5 is 0000-01-01) */
+  if(!(jd >= 1721057.5 && jd < 5373484.5))
+    return -1;
+  
+  /* Whole days (from 0h) & rounded units of the day */
+  for(unit=1, i=0; i<ndigits; i++)
+    unit *= 10;
+  perday = 86400LL * unit;
+  
+  Z = floor(jd + 0.5);
+  F = jd + 0.5 - Z;
+  ticks = llround(F * (double)perday);
+  if(ticks >= perday){
+    ticks -= perday;
+    Z += 1.;
+  }
+  
+  /* Calendar date of the day, time from the ticks */
+  atime_jd_to_date(Z - 0.5, &date);
+  secs = ticks / unit;
+  
+  atime_put_int(buf,     date.year, 4);
+  buf[4] = '-';
+  atime_put_int(buf + 5, date.month, 2);
+  buf[7] = '-';
+  atime_put_int(buf + 8, date.day, 2);
+  buf[10] = 'T';
+  atime_put_int(buf + 11, secs / 3600, 2);
+  buf[13] = ':';
+  atime_put_int(buf + 14, (secs % 3600) / 60, 2);
+  buf[16] = ':';
+  atime_put_int(buf + 17, secs % 60, 2);
+  if(ndigits){
+    buf[19] = '.';
+    atime_put_int(buf + 20, ticks % unit, ndigits);
+  }
+  buf[len] = '\0';
+  
+  return len;
+}
+
+
+/* Function for writing n JDs as ISO-8601 strings into one buffer, each
+   followed by the separator character sep.  Returns the number of bytes
+   written (not counting the final null), or -1 if buf is too small.    */
+long atime_jd_to_iso_array(const double *jd, int n, int ndigits, char sep,
+			   char *buf, size_t buflen){
+  
+  /* Variable Declarations */
+  int i,len;
+  size_t pos=0;
+  
+  for(i=0; i<n; i++){
+    len = atime_jd_to_iso(jd[i], ndigits, buf + pos, buflen - pos);
+    if(len < 0 || pos + len + 1 >= buflen)
+      return -1;
+    pos += len;
+    buf[pos++] = sep;
+  }
+  buf[pos] = '\0';
+  
+  return (long)pos;
+}
+
+
+/* Function to write a non-negative integer as exactly width digits,
+   zero-padded (not terminated) */
+static void atime_put_int(char *p, long long val, int width){
+  
+  int i;
+  
+  for(i=width-1; i>=0; i--){
+    p[i] = '0' + (char)(val % 10);
+    val /= 10;
+  }
+  
+  return;
+}
+
+
 char *atime_datestring(){
   
   /* Variable Declarations */
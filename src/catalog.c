@@ -11,11 +11,131 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>     // st_mtim / st_mtimespec, see catalog_mtime_ns()
+#endif
 
 #include <tpeb.h>
 
+#define CATALOG_CACHE_NCOL  11   // ra,dec,epoch,ra_pm,dec_pm,mag,color,pa,
+                                 // id,spectyp,pool
+#define CATALOG_CACHE_ALIGN 64   // Column alignment in the cache file
+
+// Binary cache file header; all fields in the writer's byte order
+typedef struct {
+  char     magic[8];      // "TPEBCAT"
+  uint32_t version;       // CATALOG_CACHE_VERSION
+  uint32_t endian;        // 0x01020304 as written
+  uint32_t format;        // CATALOG_LIB / CATALOG_MMT
+  uint32_t ncols;         // CATALOG_CACHE_NCOL
+  uint64_t nrows;
+  uint64_t src_size;      // Size & mtime of the source catalog
+  int64_t  src_mtime;     // st_mtime, whole seconds
+  int64_t  src_mtime_ns;  // Nanoseconds, 0 where stat() has none
+  struct {
+    char     name[8];
+    uint32_t width;       // Bytes per row (1 for the string pool)
+    uint32_t pad;
+    uint64_t offset;      // From the start of the file
+    uint64_t bytes;
+  } col[CATALOG_CACHE_NCOL];
+} catalog_cache_header;
+
+// Interning state while a string pool is being filled
+typedef struct {
+  size_t        alloc;  // Capacity of the pool
+  unsigned int *slot;   // Open-addressed table of pool offsets (0 = empty)
+  size_t        nslot;  // Power of two
+  size_t        nused;
+} catalog_pool;
+
+// Buffered output file for the catalog writers
+typedef struct {
+  int    fd;
+  char  *name;
+  char  *buf;           // CATALOG_WRITE_BUF bytes
+  size_t fill;
+} catalog_out;
+
+// Per-thread block for catalog_write_lib_mmap()
+typedef struct {
+  char              *map;
+  const catalog_lib *objects;
+  int                first;
+  int                last;
+} catalog_write_work;
+
+// Row widths of the cache columns, in file order
+static const uint32_t catalog_cache_width[CATALOG_CACHE_NCOL] =
+  {sizeof(double), sizeof(double), sizeof(double), sizeof(float),
+   sizeof(float), sizeof(float), sizeof(float), sizeof(float),
+   sizeof(unsigned int), sizeof(unsigned int), 1};
+
+// Row index / source epoch pair, for grouping rows by epoch
+typedef struct {
+  double epoch;
+  int    idx;
+} catalog_epoch_key;
+
+// Per-thread work block for catalog_propagate()
+typedef struct {
+  double *ra;           // Columns, in epoch-group order
+  double *dec;
+  const astrom_precess_plan *plans;   // One plan per group
+  const int *gstart;    // Start row of each group
+  int     ngroups;
+  int     first;        // Rows handled by this thread
+  int     last;
+} catalog_prop_work;
+
+static void *catalog_prop_worker(void *arg);
+static int   catalog_lib_line(const char *line, size_t len, void *rec);
+static int   catalog_mmt_line(const char *line, size_t len, void *rec);
+static catalog_soa *catalog_soa_alloc(int n, int format);
+static unsigned int catalog_pool_add(catalog_soa *cat, const char *str,
+				     catalog_pool *pool);
+static void  catalog_pool_done(catalog_soa *cat, catalog_pool *pool);
+static unsigned int catalog_pool_hash(const char *str);
+static void  catalog_soa_columns(const catalog_soa *cat, void *cols[]);
+static catalog_soa *catalog_read_cached(char *filename, int format,
+					int nthreads);
+static int64_t catalog_mtime_ns(const struct stat *st);
+static int   catalog_tui_line(const char *line, size_t len, void *rec);
+static int   catalog_obs_line(const char *line, size_t len, void *rec);
+static char *catalog_format_lib_line(char *p, const catalog_lib *rec);
+static char *catalog_format_mmt_line(char *p, const catalog_mmt *rec);
+static char *catalog_format_tui_line(char *p, const catalog_tui *rec);
+static char *catalog_put_dms(char *p, double deg, int c_type, int ndigits);
+static char *catalog_put_token(char *p, const char *str, int width,
+			       int maxlen);
+static void  catalog_out_open(catalog_out *out, char *filename);
+static char *catalog_out_reserve(catalog_out *out, size_t need);
+static void  catalog_out_flush(catalog_out *out);
+static void  catalog_out_close(catalog_out *out);
+static void *catalog_write_worker(void *arg);
+static int   catalog_tokens(const char *line, size_t len, char tok[][32],
+			    int maxtok);
+static void  catalog_field_copy(char *dst, const char *line, size_t len,
+				size_t start, size_t width);
+static size_t catalog_field_width(size_t len, size_t start, size_t width);
+static int   catalog_epoch_compare(const void *a, const void *b);
+static int   catalog_count_bad(const double *ra, const double *dec, int n,
+			       size_t stride);
+static void  catalog_report(const char *filename, int n, int nbad);
+
 /* Function for reading a Master Catalog into an array of catalog_lib
-   structures.
+   structures.  A row whose RA & Dec do not scan cleanly (bad syntax or
+   out of range) is kept with both set to NAN; such rows are counted in
+   the "Catalog ... has ... entries" line.
    NOTE: RA coordinates from this routine are in ddd.dddddd format!   */
 catalog_lib *catalog_read_lib(char *filename, int *n){
   
@@ -32,8 +152,6 @@ catalog_lib *catalog_read_lib(char *filename, int *n){
   /* Open catalog file & count # of entries */
   fp = fileopenr(filename);
   *n = countlines(fp);
-  
-  printf("Catalog %s has %d entries.\n",filename,*n);
     
   /* Allocate space for the structure array */
   objects = (catalog_lib *)malloc(*n * sizeof(catalog_lib)); 
@@ -62,11 +180,12 @@ catalog_lib *catalog_read_lib(char *filename, int *n){
       strncpy(f3,line+30,15);
       f3[15] = '\0';            // And why do I need this???
 
-      // Take RA & Dec, concatenate, send through parserd() & dmstodeg
+      // Take RA & Dec, concatenate, send through the scanner
       strcat(f2,space);
       strcat(f2,f3);
 
-      object = coord_parserd(f2);
+      if(coord_scan_rd(f2, strlen(f2), &object) != COORD_OK)
+	object.ra = object.dec = NAN;
       
       catline.ra  = object.ra;
       catline.dec = object.dec;
@@ -111,17 +230,75 @@ catalog_lib *catalog_read_lib(char *filename, int *n){
   
   fclose(fp);
   
+  catalog_report(filename, *n,
+		 catalog_count_bad(&objects[0].ra, &objects[0].dec, *n,
+				   sizeof(catalog_lib)));
+  
+  return objects;
+}
+
+/* Function for reading a Master Catalog into an array of catalog_lib
+   structures straight from a memory map of the file:  line ends are found
+   with memchr() and the fixed-width fields are converted in place, in a
+   single pass with no per-line copies of the whole record.  Rows with
+   a bad RA or Dec are kept & reported as for catalog_parse_lib_line().
+   NOTE: RA coordinates from this routine are in ddd.dddddd format!   */
+catalog_lib *catalog_read_lib_mmap(char *filename, int *n){
+  
+  /* Variable declarations */
+  int nalloc;
+  size_t maplen;
+  char *map;
+  const char *p,*end,*eol;
+  catalog_lib *objects;
+  
+  /* Map the catalog, guess the count from a ~100-character line */
+  map = filemapr(filename, &maplen);
+  nalloc = (int)(maplen / 100) + 16;
+  objects = (catalog_lib *)malloc(nalloc * sizeof(catalog_lib));
+  *n = 0;
+  
+  p   = map;
+  end = map + maplen;
+  while(p < end){
+    
+    eol = (const char *)memchr(p, '\n', end - p);
+    if(eol == NULL)
+      eol = end;
+    
+    // Skip comments & blank lines
+    if(*p != '#' && eol - p > 1){
+      if(*n == nalloc){
+	nalloc *= 2;
+	objects = (catalog_lib *)realloc(objects, nalloc * sizeof(catalog_lib));
+      }
+      if(catalog_parse_lib_line(p, eol - p, &objects[*n]))
+	(*n)++;
+    }
+    p = eol + 1;
+  }
+  
+  fileunmap(map, maplen);
+  
+  catalog_report(filename, *n,
+		 catalog_count_bad(&objects[0].ra, &objects[0].dec, *n,
+				   sizeof(catalog_lib)));
+  
+  if(*n > 0)
+    objects = (catalog_lib *)realloc(objects, *n * sizeof(catalog_lib));
+  
   return objects;
 }
 
 /* Function for reading an MMT-style catalog into an array of catalog_mmt
-   structures.
+   structures.  As for catalog_read_lib(), a row whose RA & Dec do not
+   scan cleanly is kept with both set to NAN & counted in the report.
    NOTE: RA coordinates from this routine are in ddd.dddddd format!   */
 catalog_mmt *catalog_read_mmt(char *filename, int *n){
   
   /* Variable declrations */
   int i;
-  char line[211],f1[20],f2[20],f3[20],f4[20],f5[20],f6[20],f7[20],f8[20];
+  char line[211],f1[20],f2[41],f3[20],f4[20],f5[20],f6[20],f7[20],f8[20];
   char *space=" ",*j2000="J2000.0",*b1950="B1950.0";
   FILE *fp;
   astrom_coords object;
@@ -131,8 +308,6 @@ catalog_mmt *catalog_read_mmt(char *filename, int *n){
   fp = fileopenr(filename);
   *n = countlines(fp);
   
-  printf("Catalog %s has %d entries.\n",filename,*n);
-  
   /* Allocate space for the structure array */
   objects = (catalog_mmt *)malloc(*n * sizeof(catalog_mmt)); 
   
@@ -144,13 +319,16 @@ catalog_mmt *catalog_read_mmt(char *filename, int *n){
     if(line[0] == '#')      // Ignore commented lines
       i--;
     else{                   // If not commented, read in line
-      sscanf(line,"%s %s %s %s %s %s %s %s",f1,f2,f3,f4,f5,f6,f7,f8);
+      sscanf(line,"%19s %19s %19s %19s %19s %19s %19s %19s",
+	     f1,f2,f3,f4,f5,f6,f7,f8);
       
-      // Take RA & Dec, concatenate, send through parserd() & dmstodeg
+      // Take RA & Dec, concatenate (f2 has room for both), send through
+      // the scanner
       strcat(f2,space);
       strcat(f2,f3);
 
-      object = coord_parserd(f2);
+      if(coord_scan_rd(f2, strlen(f2), &object) != COORD_OK)
+	object.ra = object.dec = NAN;
 
       // Parse fields into structure members
       strncpy(catline.id,line,15);
@@ -176,43 +354,1587 @@ catalog_mmt *catalog_read_mmt(char *filename, int *n){
   
   fclose(fp);
 
+  catalog_report(filename, *n,
+		 catalog_count_bad(&objects[0].ra, &objects[0].dec, *n,
+				   sizeof(catalog_mmt)));
+
   return objects;
 }
 
 /* Function for reading an TUI-style catalog into an array of catalog_tui
-   structures.
+   structures.  Each line is a name (in double quotes if it has blanks),
+   RA & Dec (see coord_scan_rd()), then an optional keyword=value list;
+   see catalog_parse_tui_line().  The file is mapped & read in one pass.
+   Rows whose position does not scan are kept with RA & Dec set to NAN,
+   and their number is reported with the entry count.
    NOTE: RA coordinates from this routine are in ddd.dddddd format!   */
 catalog_tui *catalog_read_tui(char *filename, int *n){
   
+  return catalog_read_tui_parallel(filename, n, 1);
+}
+
+
+/* Function to bring n catalog positions, held as columns, to epoch_f:
+   proper motion over (epoch_f - epoch) years, then precession from each
+   row's epoch to epoch_f.  Rows are grouped by source epoch so each group
+   is rotated with a single precession plan, and the rows are split across
+   nthreads threads (<= 0 uses all cores).  ra & dec are updated in place.
+   Proper motions follow the MMT convention:  ra_pm in seconds of RA per
+   year, dec_pm in arcseconds per year.  If stats is not NULL, the row &
+   group counts and the throughput (rows / second) are reported there. */
+void catalog_propagate(double *ra, double *dec, const float *ra_pm,
+		       const float *dec_pm, const double *epoch, int n,
+		       double epoch_f, int nthreads, catalog_prop_stats *stats){
+  
+  /* Variable Declarations */
+  int i,k,g,chunk,ngroups;
+  int *gstart;
+  double dt,*gra,*gdec;
+  struct timespec t0,t1;
+  catalog_epoch_key *keys;
+  catalog_prop_work *work;
+  astrom_precess_plan *plans;
+  
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  
+  /* Order the rows by source epoch */
+  keys = (catalog_epoch_key *)malloc((n + 1) * sizeof(catalog_epoch_key));
+  for(i=0; i<n; i++){
+    keys[i].epoch = epoch[i];
+    keys[i].idx   = i;
+  }
+  qsort(keys, n, sizeof(catalog_epoch_key), catalog_epoch_compare);
+  
+  /* Gather into group order, applying the proper motion on the way */
+  gra    = (double *)malloc(2 * ((size_t)n + 1) * sizeof(double));
+  gdec   = gra + n;
+  gstart = (int *)malloc((n + 1) * sizeof(int));
+  plans  = (astrom_precess_plan *)malloc((n + 1) *
+					 sizeof(astrom_precess_plan));
+  ngroups = 0;
+  for(i=0; i<n; i++){
+    k  = keys[i].idx;
+    dt = epoch_f - epoch[k];
+    gra[i]  = ra[k]  + ra_pm[k]  * dt * 15. / 3600.;
+    gdec[i] = dec[k] + dec_pm[k] * dt / 3600.;
+    
+    // New group -- one precession plan for all of it
+    if(i == 0 || keys[i].epoch != keys[i-1].epoch){
+      gstart[ngroups] = i;
+      plans[ngroups]  = astrom_precess_plan_get(keys[i].epoch, epoch_f);
+      ngroups++;
+    }
+  }
+  gstart[ngroups] = n;
+  
+  /* Precess, one contiguous range of rows per thread */
+  nthreads = parallel_nthreads(nthreads);
+  if(nthreads > n)
+    nthreads = (n > 0) ? n : 1;
+  chunk = (n + nthreads - 1) / nthreads;
+  
+  work = (catalog_prop_work *)malloc(nthreads * sizeof(catalog_prop_work));
+  for(g=0; g<nthreads; g++){
+    work[g].ra      = gra;
+    work[g].dec     = gdec;
+    work[g].plans   = plans;
+    work[g].gstart  = gstart;
+    work[g].ngroups = ngroups;
+    work[g].first   = g * chunk;
+    work[g].last    = ((g + 1) * chunk < n) ? (g + 1) * chunk : n;
+  }
+  parallel_run(nthreads, catalog_prop_worker, work,
+	       sizeof(catalog_prop_work));
+  
+  /* Scatter back to catalog order */
+  for(i=0; i<n; i++){
+    ra[keys[i].idx]  = gra[i];
+    dec[keys[i].idx] = gdec[i];
+  }
+  
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  
+  if(stats != NULL){
+    stats->rows    = n;
+    stats->groups  = ngroups;
+    stats->seconds = (t1.tv_sec - t0.tv_sec) + 1.e-9 *
+      (t1.tv_nsec - t0.tv_nsec);
+    stats->rows_per_sec = (stats->seconds > 0.) ? n / stats->seconds : 0.;
+  }
+  
+  free(work);
+  free(plans);
+  free(gstart);
+  free(gra);
+  free(keys);
+  
+  return;
+}
+
+
+/* Function to bring a catalog_lib array to epoch_f with catalog_propagate().
+   If ra_out & dec_out are NULL the catalog is updated in place (including
+   its epoch field); otherwise the new positions go to those columns and
+   the catalog is left untouched.                                       */
+void catalog_propagate_lib(catalog_lib *objects, int n, double epoch_f,
+			   double *ra_out, double *dec_out, int nthreads,
+			   catalog_prop_stats *stats){
+  
+  /* Variable Declarations */
+  int i,inplace;
+  double *ra,*dec,*epoch;
+  float *pm;
+  
+  inplace = (ra_out == NULL || dec_out == NULL);
+  
+  /* Gather the columns */
+  ra    = (inplace) ? (double *)malloc(2 * ((size_t)n + 1) * sizeof(double))
+    : ra_out;
+  dec   = (inplace) ? ra + n : dec_out;
+  epoch = (double *)calloc(n + 1, sizeof(double));
+  pm    = (float *)calloc(2 * ((size_t)n + 1), sizeof(float));
+  for(i=0; i<n; i++){
+    ra[i]    = objects[i].ra;
+    dec[i]   = objects[i].dec;
+    epoch[i] = objects[i].epoch;
+    pm[i]    = objects[i].ra_pm;
+    pm[n+i]  = objects[i].dec_pm;
+  }
+  
+  catalog_propagate(ra, dec, pm, pm + n, epoch, n, epoch_f, nthreads, stats);
+  
+  if(inplace){
+    for(i=0; i<n; i++){
+      objects[i].ra    = ra[i];
+      objects[i].dec   = dec[i];
+      objects[i].epoch = epoch_f;
+    }
+    free(ra);
+  }
+  
+  free(epoch);
+  free(pm);
+  
+  return;
+}
+
+
+/* Function to bring a catalog_mmt array to epoch_f, as for
+   catalog_propagate_lib() */
+void catalog_propagate_mmt(catalog_mmt *objects, int n, double epoch_f,
+			   double *ra_out, double *dec_out, int nthreads,
+			   catalog_prop_stats *stats){
+  
+  /* Variable Declarations */
+  int i,inplace;
+  double *ra,*dec,*epoch;
+  float *pm;
+  
+  inplace = (ra_out == NULL || dec_out == NULL);
+  
+  /* Gather the columns */
+  ra    = (inplace) ? (double *)malloc(2 * ((size_t)n + 1) * sizeof(double))
+    : ra_out;
+  dec   = (inplace) ? ra + n : dec_out;
+  epoch = (double *)calloc(n + 1, sizeof(double));
+  pm    = (float *)calloc(2 * ((size_t)n + 1), sizeof(float));
+  for(i=0; i<n; i++){
+    ra[i]    = objects[i].ra;
+    dec[i]   = objects[i].dec;
+    epoch[i] = objects[i].epoch;
+    pm[i]    = objects[i].ra_pm;
+    pm[n+i]  = objects[i].dec_pm;
+  }
+  
+  catalog_propagate(ra, dec, pm, pm + n, epoch, n, epoch_f, nthreads, stats);
+  
+  if(inplace){
+    for(i=0; i<n; i++){
+      objects[i].ra    = ra[i];
+      objects[i].dec   = dec[i];
+      objects[i].epoch = epoch_f;
+    }
+    free(ra);
+  }
+  
+  free(epoch);
+  free(pm);
+  
+  return;
+}
+
+
+/* Thread worker:  precess rows first .. last-1, group by group */
+static void *catalog_prop_worker(void *arg){
+  
+  /* Variable Declarations */
+  int g,lo,hi;
+  catalog_prop_work *work = (catalog_prop_work *)arg;
+  
+  for(g=0; g<work->ngroups; g++){
+    lo = (work->gstart[g]   > work->first) ? work->gstart[g]   : work->first;
+    hi = (work->gstart[g+1] < work->last)  ? work->gstart[g+1] : work->last;
+    if(lo < hi)
+      astrom_precess_apply(&work->plans[g], work->ra + lo, work->dec + lo,
+			   hi - lo);
+  }
+  
+  return NULL;
+}
+
+
+/* Comparison function for qsort() -- by epoch, then row */
+static int catalog_epoch_compare(const void *a, const void *b){
+  
+  const catalog_epoch_key *ka = (const catalog_epoch_key *)a;
+  const catalog_epoch_key *kb = (const catalog_epoch_key *)b;
+  
+  if(ka->epoch < kb->epoch) return -1;
+  if(ka->epoch > kb->epoch) return  1;
+  return ka->idx - kb->idx;
+}
+
+
+/* Function to fill a catalog_lib record from one Master Catalog line of
+   len characters (not null-terminated, may lack trailing fields).  An
+   RA or Dec field that is malformed or out of range is set to NAN (the
+   record is still read; the readers count & report such rows).
+   Returns 1 if a record was read, 0 for comment ('#') and blank lines. */
+int catalog_parse_lib_line(const char *line, size_t len, catalog_lib *rec){
+  
+  /* Variable Declarations */
+  char buf[32];
+  
+  if(len > 0 && line[len-1] == '\n')
+    len--;
+  if(len > 0 && line[len-1] == '\r')
+    len--;
+  if(len == 0 || line[0] == '#')
+    return 0;
+  
+  // 15 characters for Object Name
+  catalog_field_copy(rec->id, line, len, 0, 15);
+  
+  // 15 characters each for R.A. & Dec, scanned in place (NAN if bad)
+  if(coord_scan_angle(line + 15, catalog_field_width(len, 15, 15),
+		      COORD_RA, &rec->ra) != COORD_OK)
+    rec->ra = NAN;
+  if(coord_scan_angle(line + 30, catalog_field_width(len, 30, 15),
+		      COORD_DEC, &rec->dec) != COORD_OK)
+    rec->dec = NAN;
+  
+  // 5 characters each for Proper Motions
+  catalog_field_copy(buf, line, len, 45, 5);
+  rec->ra_pm  = atof(buf);
+  catalog_field_copy(buf, line, len, 50, 5);
+  rec->dec_pm = atof(buf);
+  
+  // 10 characters each for Magnitude, Color & Spectral Type
+  catalog_field_copy(buf, line, len, 55, 10);
+  rec->mag   = atof(buf);
+  catalog_field_copy(buf, line, len, 65, 10);
+  rec->color = atof(buf);
+  catalog_field_copy(rec->spectyp, line, len, 75, 10);
+  
+  // 10 characters for the Epoch
+  catalog_field_copy(buf, line, len, 85, 10);
+  if(strchr(buf,'J') != NULL)
+    rec->epoch = 2000.0;
+  else if(strchr(buf,'B') != NULL)
+    rec->epoch = 1950.0;
+  else
+    rec->epoch = atof(buf);
+  
+  // 10 characters for the Position Angle
+  catalog_field_copy(buf, line, len, 95, 10);
+  rec->pa = atof(buf);
+  
+  return 1;
+}
+
+
+/* Function to fill a catalog_mmt record from one MMT-style catalog line
+   of len characters (8 blank-separated fields, need not be terminated).
+   A malformed or out-of-range RA or Dec is set to NAN, as for
+   catalog_parse_lib_line().
+   Returns 1 if a record was read, 0 for comment, blank or short lines. */
+int catalog_parse_mmt_line(const char *line, size_t len, catalog_mmt *rec){
+  
+  /* Variable Declarations */
+  char f[8][32];
+  
+  if(len == 0 || line[0] == '#' ||
+     catalog_tokens(line, len, f, 8) < 8)
+    return 0;
+  
+  // RA & Dec (NAN if they do not scan, or are out of range)
+  if(coord_scan_angle(f[1], sizeof(f[1]), COORD_RA, &rec->ra) != COORD_OK)
+    rec->ra = NAN;
+  if(coord_scan_angle(f[2], sizeof(f[2]), COORD_DEC, &rec->dec) != COORD_OK)
+    rec->dec = NAN;
+  
+  // Parse fields into structure members
+  catalog_field_copy(rec->id, line, len, 0, 15);
+  rec->ra_pm   = atof(f[3]);
+  rec->dec_pm  = atof(f[4]);
+  rec->mag     = atof(f[5]);
+  strcpy(rec->spectyp, f[6]);
+  
+  if(!strcmp(f[7],"J2000.0"))
+    rec->epoch = 2000.0;
+  else if(!strcmp(f[7],"B1950.0"))
+    rec->epoch = 1950.0;
+  else
+    rec->epoch = atof(f[7]);
+  
+  return 1;
+}
+
+
+/* Function to fill a catalog_tui record from one TUI catalog line of len
+   characters (need not be terminated):
+      "Object name"  HH:MM:SS.ss +DD:MM:SS.s  Key=Value Key=Value ...
+   The name may be unquoted if it has no blanks; the position takes any
+   form coord_scan_rd() reads (both NAN if it is malformed or out of
+   range; the record is still read); the keyword list
+   starts at the first field holding an '=' and is kept as text.
+   Returns 1 if a record was read, 0 for comment ('#') and blank lines. */
+int catalog_parse_tui_line(const char *line, size_t len, catalog_tui *rec){
+  
+  /* Variable Declarations */
+  size_t i,k,start,kw;
+  char quote;
+  astrom_coords object;
+  
+  /* Trim the line end & leading blanks */
+  while(len > 0 && (line[len-1] == '\n' || line[len-1] == '\r' ||
+		    line[len-1] == ' ' || line[len-1] == '\t'))
+    len--;
+  for(i=0; i<len && (line[i] == ' ' || line[i] == '\t'); i++);
+  if(i == len || line[i] == '#')
+    return 0;
+  
+  /* Name:  quoted, or up to the first blank */
+  k = 0;
+  if(line[i] == '"' || line[i] == '\''){
+    quote = line[i++];
+    for(; i<len && line[i] != quote; i++)
+      if(k < sizeof(rec->id) - 1)
+	rec->id[k++] = line[i];
+    if(i < len)
+      i++;
+  }
+  else
+    for(; i<len && line[i] != ' ' && line[i] != '\t'; i++)
+      if(k < sizeof(rec->id) - 1)
+	rec->id[k++] = line[i];
+  rec->id[k] = '\0';
+  
+  /* Keywords begin at the first blank-separated field with an '=' */
+  start = i;
+  for(kw=i; kw<len; ){
+    while(kw < len && (line[kw] == ' ' || line[kw] == '\t'))
+      kw++;
+    for(k=kw; k<len && line[k] != ' ' && line[k] != '\t' &&
+	  line[k] != '='; k++);
+    if(k < len && line[k] == '=')
+      break;
+    while(kw < len && line[kw] != ' ' && line[kw] != '\t')
+      kw++;
+  }
+  
+  /* Position from the text in between */
+  if(coord_scan_rd(line + start, kw - start, &object) != COORD_OK)
+    object.ra = object.dec = NAN;
+  rec->ra  = object.ra;
+  rec->dec = object.dec;
+  
+  /* Keyword list, kept as is */
+  catalog_field_copy(rec->keywords, line, len, kw,
+		     sizeof(rec->keywords) - 1);
+  
+  return 1;
+}
+
+
+/* Function for reading a TUI-style catalog with its lines split across
+   nthreads threads (<= 0 uses all cores).  Rows with a bad position are
+   kept (RA & Dec NAN) & counted, as for catalog_read_tui().
+   NOTE: RA coordinates from this routine are in ddd.dddddd format!   */
+catalog_tui *catalog_read_tui_parallel(char *filename, int *n, int nthreads){
+  
+  /* Variable Declarations */
+  catalog_tui *objects;
+  
+  objects = (catalog_tui *)parallel_parse_file(filename, sizeof(catalog_tui),
+					       catalog_tui_line, nthreads, n);
+  
+  catalog_report(filename, *n,
+		 catalog_count_bad(&objects[0].ra, &objects[0].dec, *n,
+				   sizeof(catalog_tui)));
+  
+  return objects;
+}
+
+
+/* Function for reading a Master Catalog with its lines split across
+   nthreads threads (<= 0 uses all cores).  Same records, in the same
+   order, as catalog_read_lib(); bad RA / Dec fields are NAN & counted as
+   for catalog_parse_lib_line().
+   NOTE: RA coordinates from this routine are in ddd.dddddd format!   */
+catalog_lib *catalog_read_lib_parallel(char *filename, int *n, int nthreads){
+  
+  /* Variable Declarations */
+  catalog_lib *objects;
+  
+  objects = (catalog_lib *)parallel_parse_file(filename, sizeof(catalog_lib),
+					       catalog_lib_line, nthreads, n);
+  
+  catalog_report(filename, *n,
+		 catalog_count_bad(&objects[0].ra, &objects[0].dec, *n,
+				   sizeof(catalog_lib)));
+  
+  return objects;
+}
+
+
+/* Function for reading an MMT-style catalog with its lines split across
+   nthreads threads (<= 0 uses all cores).  Bad RA / Dec fields are NAN &
+   counted, as for catalog_parse_mmt_line().
+   NOTE: RA coordinates from this routine are in ddd.dddddd format!   */
+catalog_mmt *catalog_read_mmt_parallel(char *filename, int *n, int nthreads){
+  
+  /* Variable Declarations */
+  catalog_mmt *objects;
+  
+  objects = (catalog_mmt *)parallel_parse_file(filename, sizeof(catalog_mmt),
+					       catalog_mmt_line, nthreads, n);
+  
+  catalog_report(filename, *n,
+		 catalog_count_bad(&objects[0].ra, &objects[0].dec, *n,
+				   sizeof(catalog_mmt)));
+  
+  return objects;
+}
+
+
+/* Function to copy n catalog_lib records into a new columnar catalog */
+catalog_soa *catalog_soa_from_lib(const catalog_lib *objects, int n){
+  
   /* Variable Declarations */
   int i;
-  char line[211];//,*space=" ";
-  FILE *fp;
-  catalog_tui *objects;//,catline;
+  catalog_pool pool = {0, NULL, 0, 0};
+  catalog_soa *cat;
   
-  /* Open catalog file & count # of entries */
-  fp = fileopenr(filename);
-  *n = countlines(fp);
+  cat = catalog_soa_alloc(n, CATALOG_LIB);
+  for(i=0; i<n; i++){
+    cat->ra[i]      = objects[i].ra;
+    cat->dec[i]     = objects[i].dec;
+    cat->epoch[i]   = objects[i].epoch;
+    cat->ra_pm[i]   = objects[i].ra_pm;
+    cat->dec_pm[i]  = objects[i].dec_pm;
+    cat->mag[i]     = objects[i].mag;
+    cat->color[i]   = objects[i].color;
+    cat->pa[i]      = objects[i].pa;
+    cat->id[i]      = catalog_pool_add(cat, objects[i].id, &pool);
+    cat->spectyp[i] = catalog_pool_add(cat, objects[i].spectyp, &pool);
+  }
+  catalog_pool_done(cat, &pool);
   
-  printf("Catalog %s has %d entries.\n",filename,*n);
+  return cat;
+}
+
+
+/* Function to copy n catalog_mmt records into a new columnar catalog
+   (color & pa, which the MMT format lacks, are zero) */
+catalog_soa *catalog_soa_from_mmt(const catalog_mmt *objects, int n){
   
-  /* Allocate space for the structure array */
-  objects = (catalog_tui *)malloc(*n * sizeof(catalog_tui)); 
+  /* Variable Declarations */
+  int i;
+  catalog_pool pool = {0, NULL, 0, 0};
+  catalog_soa *cat;
   
-  /* FOR loop reading in the lines of the catalog file */
-  for(i=0; i<*n; i++){
-    
-    // Get the line first, check for '#'. then read in 8 fields
-    fgets(line,210,fp);
-    if(line[0] == '#')      // Ignore commented lines
-      i--;
-    else{                   // If not commented, read in line
-      
-     
-    } 
+  cat = catalog_soa_alloc(n, CATALOG_MMT);
+  for(i=0; i<n; i++){
+    cat->ra[i]      = objects[i].ra;
+    cat->dec[i]     = objects[i].dec;
+    cat->epoch[i]   = objects[i].epoch;
+    cat->ra_pm[i]   = objects[i].ra_pm;
+    cat->dec_pm[i]  = objects[i].dec_pm;
+    cat->mag[i]     = objects[i].mag;
+    cat->color[i]   = 0.;
+    cat->pa[i]      = 0.;
+    cat->id[i]      = catalog_pool_add(cat, objects[i].id, &pool);
+    cat->spectyp[i] = catalog_pool_add(cat, objects[i].spectyp, &pool);
   }
+  catalog_pool_done(cat, &pool);
+  
+  return cat;
+}
 
-  fclose(fp);
+
+/* Functions returning the id & spectral type strings of row i */
+const char *catalog_soa_id(const catalog_soa *cat, int i){
+  return (cat->id[i] < cat->poolsize) ? cat->pool + cat->id[i] : "";
+}
+
+const char *catalog_soa_spectyp(const catalog_soa *cat, int i){
+  return (cat->spectyp[i] < cat->poolsize) ? cat->pool + cat->spectyp[i] : "";
+}
+
+
+/* Function to copy a columnar catalog back out to a catalog_lib array */
+catalog_lib *catalog_soa_to_lib(const catalog_soa *cat){
+  
+  /* Variable Declarations */
+  int i;
+  catalog_lib *objects;
+  
+  objects = (catalog_lib *)malloc((cat->n > 0 ? cat->n : 1) *
+				  sizeof(catalog_lib));
+  for(i=0; i<cat->n; i++){
+    strncpy(objects[i].id, catalog_soa_id(cat, i), 49);
+    objects[i].id[49] = '\0';
+    strncpy(objects[i].spectyp, catalog_soa_spectyp(cat, i), 49);
+    objects[i].spectyp[49] = '\0';
+    objects[i].ra     = cat->ra[i];
+    objects[i].dec    = cat->dec[i];
+    objects[i].ra_pm  = cat->ra_pm[i];
+    objects[i].dec_pm = cat->dec_pm[i];
+    objects[i].mag    = cat->mag[i];
+    objects[i].color  = cat->color[i];
+    objects[i].epoch  = cat->epoch[i];
+    objects[i].pa     = cat->pa[i];
+  }
+  
+  return objects;
+}
+
+
+/* Function to copy a columnar catalog back out to a catalog_mmt array */
+catalog_mmt *catalog_soa_to_mmt(const catalog_soa *cat){
+  
+  /* Variable Declarations */
+  int i;
+  catalog_mmt *objects;
+  
+  objects = (catalog_mmt *)malloc((cat->n > 0 ? cat->n : 1) *
+				  sizeof(catalog_mmt));
+  for(i=0; i<cat->n; i++){
+    strncpy(objects[i].id, catalog_soa_id(cat, i), 49);
+    objects[i].id[49] = '\0';
+    strncpy(objects[i].spectyp, catalog_soa_spectyp(cat, i), 49);
+    objects[i].spectyp[49] = '\0';
+    objects[i].ra     = cat->ra[i];
+    objects[i].dec    = cat->dec[i];
+    objects[i].ra_pm  = cat->ra_pm[i];
+    objects[i].dec_pm = cat->dec_pm[i];
+    objects[i].mag    = cat->mag[i];
+    objects[i].epoch  = cat->epoch[i];
+  }
   
   return objects;
 }
+
+
+/* Function returning the (malloc'd) indices of the *nfound rows with
+   mag_min <= mag <= mag_max.  Only the magnitude column is read, and the
+   loop stores every index & advances by the test, so it has no branch. */
+int *catalog_soa_mag_cut(const catalog_soa *cat, float mag_min,
+			 float mag_max, int *nfound){
+  
+  /* Variable Declarations */
+  int i,k=0;
+  int *idx;
+  const float *mag = cat->mag;
+  
+  idx = (int *)malloc((cat->n + 1) * sizeof(int));
+  for(i=0; i<cat->n; i++){
+    idx[k] = i;
+    k += (mag[i] >= mag_min) & (mag[i] <= mag_max);
+  }
+  
+  *nfound = k;
+  return idx;
+}
+
+
+/* Function returning the (malloc'd) indices of the *nfound rows within
+   radius degrees of center.  Rows outside the declination band are
+   rejected from the dec column alone; the rest are tested exactly.    */
+int *catalog_soa_cone(const catalog_soa *cat, const astrom_coords *center,
+		      double radius, int *nfound){
+  
+  /* Variable Declarations */
+  int i,k=0;
+  int *idx;
+  double cx,cy,cz,cos_r,dec_lo,dec_hi,alpha,delta,cd;
+  
+  astrom_unit_vector(center->ra, center->dec, &cx, &cy, &cz);
+  cos_r  = cos(radius * DEG2RAD);
+  dec_lo = center->dec - radius;
+  dec_hi = center->dec + radius;
+  
+  idx = (int *)malloc((cat->n + 1) * sizeof(int));
+  for(i=0; i<cat->n; i++){
+    if(cat->dec[i] < dec_lo || cat->dec[i] > dec_hi)
+      continue;
+    alpha = cat->ra[i]  * DEG2RAD;
+    delta = cat->dec[i] * DEG2RAD;
+    cd    = cos(delta);
+    if(cd * cos(alpha) * cx + cd * sin(alpha) * cy + sin(delta) * cz >= cos_r)
+      idx[k++] = i;
+  }
+  
+  *nfound = k;
+  return idx;
+}
+
+
+/* Function to release a columnar catalog, mapped or allocated */
+void catalog_soa_free(catalog_soa *cat){
+  
+  if(cat == NULL)
+    return;
+  
+  if(cat->map != NULL)
+    munmap(cat->map, cat->maplen);
+  else{
+    free(cat->ra);
+    free(cat->dec);
+    free(cat->epoch);
+    free(cat->ra_pm);
+    free(cat->dec_pm);
+    free(cat->mag);
+    free(cat->color);
+    free(cat->pa);
+    free(cat->id);
+    free(cat->spectyp);
+    free(cat->pool);
+  }
+  free(cat);
+  
+  return;
+}
+
+
+/* Function to write a columnar catalog as a binary cache file:  a header
+   (magic, version, byte-order mark, format, row count, the size & mtime
+   of source if not NULL, and a column directory) followed by each column,
+   64-byte aligned.  The file is written under a temporary name & renamed
+   into place.  Returns 0, or -1 if it could not be written.           */
+int catalog_cache_write(const catalog_soa *cat, char *filename,
+			const struct stat *source){
+  
+  /* Variable Declarations */
+  int k,ok;
+  uint64_t off;
+  char *tmpname,zeros[CATALOG_CACHE_ALIGN];
+  void *cols[CATALOG_CACHE_NCOL];
+  static const char *names[CATALOG_CACHE_NCOL] =
+    {"ra","dec","epoch","ra_pm","dec_pm","mag","color","pa","id","spectyp",
+     "pool"};
+  FILE *fp;
+  catalog_cache_header hdr;
+  
+  /* Header & column directory */
+  memset(&hdr, 0, sizeof(hdr));
+  memset(zeros, 0, sizeof(zeros));
+  strcpy(hdr.magic, "TPEBCAT");
+  hdr.version = CATALOG_CACHE_VERSION;
+  hdr.endian  = 0x01020304;
+  hdr.format  = cat->format;
+  hdr.ncols   = CATALOG_CACHE_NCOL;
+  hdr.nrows   = cat->n;
+  if(source != NULL){
+    hdr.src_size     = source->st_size;
+    hdr.src_mtime    = source->st_mtime;
+    hdr.src_mtime_ns = catalog_mtime_ns(source);
+  }
+  
+  catalog_soa_columns(cat, cols);
+  off = sizeof(hdr);
+  for(k=0; k<CATALOG_CACHE_NCOL; k++){
+    off = (off + CATALOG_CACHE_ALIGN - 1) / CATALOG_CACHE_ALIGN *
+      CATALOG_CACHE_ALIGN;
+    strncpy(hdr.col[k].name, names[k], 7);
+    hdr.col[k].width  = catalog_cache_width[k];
+    hdr.col[k].offset = off;
+    hdr.col[k].bytes  = (k == CATALOG_CACHE_NCOL - 1) ? cat->poolsize :
+      (uint64_t)cat->n * catalog_cache_width[k];
+    off += hdr.col[k].bytes;
+  }
+  
+  /* Write under a temporary name, then move into place */
+  tmpname = (char *)malloc(strlen(filename) + 8);
+  sprintf(tmpname, "%s.tmp", filename);
+  if((fp=fopen(tmpname,"wb")) == NULL){
+    free(tmpname);
+    return -1;
+  }
+  
+  ok = (fwrite(&hdr, sizeof(hdr), 1, fp) == 1);
+  off = sizeof(hdr);
+  for(k=0; k<CATALOG_CACHE_NCOL && ok; k++){
+    ok = (fwrite(zeros, 1, hdr.col[k].offset - off, fp) ==
+	  hdr.col[k].offset - off);
+    if(ok && hdr.col[k].bytes > 0)
+      ok = (fwrite(cols[k], 1, hdr.col[k].bytes, fp) == hdr.col[k].bytes);
+    off = hdr.col[k].offset + hdr.col[k].bytes;
+  }
+  
+  if(fclose(fp) != 0)
+    ok = 0;
+  if(ok)
+    ok = (rename(tmpname, filename) == 0);
+  if(!ok)
+    remove(tmpname);
+  free(tmpname);
+  
+  return (ok) ? 0 : -1;
+}
+
+
+/* Function to map a binary cache file & return a columnar catalog whose
+   columns point straight into the mapping (no copies).  If source is not
+   NULL the cache must have been written from a file of that size & mtime.
+   Returns NULL if the file is missing, stale or not a valid cache.     */
+catalog_soa *catalog_cache_map(char *filename, const struct stat *source){
+  
+  /* Variable Declarations */
+  int fd,k,ok;
+  char *map;
+  struct stat st;
+  catalog_cache_header hdr;
+  catalog_soa *cat;
+  
+  if((fd=open(filename,O_RDONLY)) < 0)
+    return NULL;
+  if(fstat(fd,&st) < 0 || (size_t)st.st_size < sizeof(hdr)){
+    close(fd);
+    return NULL;
+  }
+  map = (char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+    return NULL;
+  
+  /* Check the header against this build & the source file */
+  memcpy(&hdr, map, sizeof(hdr));
+  ok = (!memcmp(hdr.magic, "TPEBCAT", 8) &&
+	hdr.version == CATALOG_CACHE_VERSION && hdr.endian == 0x01020304 &&
+	hdr.ncols == CATALOG_CACHE_NCOL && hdr.nrows <= INT_MAX &&
+	(hdr.format == CATALOG_LIB || hdr.format == CATALOG_MMT));
+  if(ok && source != NULL)
+    ok = (hdr.src_size == (uint64_t)source->st_size &&
+	  hdr.src_mtime == (int64_t)source->st_mtime &&
+	  hdr.src_mtime_ns == catalog_mtime_ns(source));
+  
+  /* Column directory must agree with this layout & fit in the file */
+  for(k=0; k<CATALOG_CACHE_NCOL && ok; k++)
+    ok = (hdr.col[k].width == catalog_cache_width[k] &&
+	  hdr.col[k].offset % CATALOG_CACHE_ALIGN == 0 &&
+	  hdr.col[k].offset <= (uint64_t)st.st_size &&
+	  hdr.col[k].bytes <= (uint64_t)st.st_size - hdr.col[k].offset &&
+	  (k == CATALOG_CACHE_NCOL - 1 || 
+	   hdr.col[k].bytes == hdr.nrows * catalog_cache_width[k]));
+  if(ok)
+    ok = (hdr.col[CATALOG_CACHE_NCOL-1].bytes > 0 &&
+	  map[hdr.col[CATALOG_CACHE_NCOL-1].offset +
+	      hdr.col[CATALOG_CACHE_NCOL-1].bytes - 1] == '\0');
+  if(!ok){
+    munmap(map, st.st_size);
+    return NULL;
+  }
+  
+  /* Point the columns into the mapping */
+  cat = (catalog_soa *)calloc(1, sizeof(catalog_soa));
+  cat->n        = (int)hdr.nrows;
+  cat->format   = hdr.format;
+  cat->ra       = (double *)(map + hdr.col[0].offset);
+  cat->dec      = (double *)(map + hdr.col[1].offset);
+  cat->epoch    = (double *)(map + hdr.col[2].offset);
+  cat->ra_pm    = (float *)(map + hdr.col[3].offset);
+  cat->dec_pm   = (float *)(map + hdr.col[4].offset);
+  cat->mag      = (float *)(map + hdr.col[5].offset);
+  cat->color    = (float *)(map + hdr.col[6].offset);
+  cat->pa       = (float *)(map + hdr.col[7].offset);
+  cat->id       = (unsigned int *)(map + hdr.col[8].offset);
+  cat->spectyp  = (unsigned int *)(map + hdr.col[9].offset);
+  cat->pool     = map + hdr.col[10].offset;
+  cat->poolsize = hdr.col[10].bytes;
+  cat->map      = map;
+  cat->maplen   = st.st_size;
+  
+  return cat;
+}
+
+
+/* Functions for reading a Master / MMT-style catalog through a sidecar
+   binary cache (filename + CATALOG_CACHE_EXT):  if the cache matches the
+   size & mtime of the catalog it is mapped as is, otherwise the catalog
+   is parsed (nthreads threads, <= 0 for all cores) and the cache is
+   rewritten for next time.
+   NOTE: RA coordinates from these routines are in ddd.dddddd format! */
+catalog_soa *catalog_read_lib_cached(char *filename, int nthreads){
+  return catalog_read_cached(filename, CATALOG_LIB, nthreads);
+}
+
+catalog_soa *catalog_read_mmt_cached(char *filename, int nthreads){
+  return catalog_read_cached(filename, CATALOG_MMT, nthreads);
+}
+
+
+/* Function that returns the nanoseconds of a file's mtime, for the cache
+   key:  st_mtim (Linux & most POSIX) or st_mtimespec (macOS, BSD), as
+   found by configure; 0 where stat() has whole seconds only.          */
+static int64_t catalog_mtime_ns(const struct stat *st){
+  
+#if defined(HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+  return (int64_t)st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC_TV_NSEC)
+  return (int64_t)st->st_mtimespec.tv_nsec;
+#else
+  return 0;
+#endif
+}
+
+
+/* Function behind catalog_read_lib_cached() & catalog_read_mmt_cached() */
+static catalog_soa *catalog_read_cached(char *filename, int format,
+					int nthreads){
+  
+  /* Variable Declarations */
+  int n;
+  char *cachename;
+  struct stat st;
+  catalog_lib *lib;
+  catalog_mmt *mmt;
+  catalog_soa *cat;
+  
+  if(stat(filename,&st) < 0){
+    fprintf(stderr,"\nError opening file %s\n",filename);
+    exit(1);
+  }
+  
+  cachename = (char *)malloc(strlen(filename) + strlen(CATALOG_CACHE_EXT) + 1);
+  sprintf(cachename, "%s%s", filename, CATALOG_CACHE_EXT);
+  
+  /* Fresh cache of the right format? */
+  cat = catalog_cache_map(cachename, &st);
+  if(cat != NULL && cat->format == format){
+    catalog_report(filename, cat->n,
+		   catalog_count_bad(cat->ra, cat->dec, cat->n, sizeof(double)));
+    free(cachename);
+    return cat;
+  }
+  catalog_soa_free(cat);
+  
+  /* Parse the catalog and (try to) refresh the cache */
+  if(format == CATALOG_LIB){
+    lib = catalog_read_lib_parallel(filename, &n, nthreads);
+    cat = catalog_soa_from_lib(lib, n);
+    free(lib);
+  }
+  else{
+    mmt = catalog_read_mmt_parallel(filename, &n, nthreads);
+    cat = catalog_soa_from_mmt(mmt, n);
+    free(mmt);
+  }
+  catalog_cache_write(cat, cachename, &st);
+  
+  free(cachename);
+  return cat;
+}
+
+
+/* Function to open filename for one-pass reading in batches with
+   catalog_stream_next().  Only a fixed CATALOG_STREAM_BUF-byte window of
+   the file is held in memory, so catalogs of any size can be processed.
+   format is CATALOG_LIB, CATALOG_MMT, CATALOG_TUI (records are
+   catalog_lib / catalog_mmt / catalog_tui) or CATALOG_OBS
+   (astrom_location).
+
+   Calling sequence:
+     st = catalog_stream_open(filename, CATALOG_LIB);
+     while((k = catalog_stream_next(st, batch, K)) > 0)
+       ... batch[0 .. k-1] ...
+     catalog_stream_close(st);                                           */
+catalog_stream *catalog_stream_open(char *filename, int format){
+  
+  /* Variable Declarations */
+  catalog_stream *st;
+  
+  st = (catalog_stream *)calloc(1, sizeof(catalog_stream));
+  st->format = format;
+  switch(format){
+  case CATALOG_LIB:
+    st->recsize = sizeof(catalog_lib);
+    st->parse   = catalog_lib_line;
+    break;
+  case CATALOG_MMT:
+    st->recsize = sizeof(catalog_mmt);
+    st->parse   = catalog_mmt_line;
+    break;
+  case CATALOG_TUI:
+    st->recsize = sizeof(catalog_tui);
+    st->parse   = catalog_tui_line;
+    break;
+  case CATALOG_OBS:
+    st->recsize = sizeof(astrom_location);
+    st->parse   = catalog_obs_line;
+    break;
+  default:
+    fprintf(stderr,"\nUnknown catalog format %d for %s\n",format,filename);
+    exit(1);
+  }
+  
+  st->fp  = fileopenr(filename);
+  st->buf = (char *)malloc(CATALOG_STREAM_BUF);
+  
+  return st;
+}
+
+
+/* Function to read up to k more records from a catalog stream into recs
+   (room for k records of the stream's type).  Comment & blank lines are
+   skipped.  Returns the number read; 0 once the file is exhausted.     */
+int catalog_stream_next(catalog_stream *st, void *recs, int k){
+  
+  /* Variable Declarations */
+  int n=0;
+  size_t len,got;
+  char *line,*eol;
+  
+  while(n < k){
+    
+    line = st->buf + st->pos;
+    len  = st->fill - st->pos;
+    eol  = (char *)memchr(line, '\n', len);
+    
+    /* No complete line left:  slide the partial one down & refill */
+    if(eol == NULL && !st->eof && len < CATALOG_STREAM_BUF){
+      memmove(st->buf, line, len);
+      st->pos  = 0;
+      got      = fread(st->buf + len, 1, CATALOG_STREAM_BUF - len, st->fp);
+      st->fill = len + got;
+      st->eof  = (got < CATALOG_STREAM_BUF - len);
+      continue;
+    }
+    
+    /* Still dropping the tail of an over-long line */
+    if(st->skip){
+      st->pos  = (eol != NULL) ? (size_t)(eol - st->buf) + 1 : st->fill;
+      st->skip = (eol == NULL);
+      if(eol == NULL && st->eof)
+	break;
+      continue;
+    }
+    
+    /* Last line without a newline, or a line longer than the buffer
+       (parsed from what fits, the rest is skipped) */
+    if(eol == NULL){
+      if(len == 0)
+	break;
+      eol = st->buf + st->fill;
+      st->skip = !st->eof;
+    }
+    
+    len     = eol - line;
+    st->pos = (eol < st->buf + st->fill) ? (size_t)(eol - st->buf) + 1 :
+      st->fill;
+    
+    if(len == 0 || line[0] == '#' || (len == 1 && line[0] == '\r'))
+      continue;
+    if(st->parse(line, len, (char *)recs + n * st->recsize))
+      n++;
+  }
+  
+  st->nrows += n;
+  return n;
+}
+
+
+/* Function to close a catalog stream & release its buffer */
+void catalog_stream_close(catalog_stream *st){
+  
+  if(st == NULL)
+    return;
+  
+  fclose(st->fp);
+  free(st->buf);
+  free(st);
+  
+  return;
+}
+
+
+/* Function to call fn(record, user) for every record of a catalog file,
+   in one pass with bounded memory (see catalog_stream_open() for the
+   formats).  fn returns 0 to go on, anything else to stop early.
+   Returns the number of records visited.                              */
+long catalog_foreach(char *filename, int format,
+		     int (*fn)(void *rec, void *user), void *user){
+  
+  /* Variable Declarations */
+  int i,k,stop=0;
+  long nrows=0;
+  char *batch;
+  catalog_stream *st;
+  
+  st    = catalog_stream_open(filename, format);
+  batch = (char *)malloc(1024 * st->recsize);
+  
+  while(!stop && (k = catalog_stream_next(st, batch, 1024)) > 0)
+    for(i=0; i<k && !stop; i++){
+      nrows++;
+      stop = fn(batch + i * st->recsize, user);
+    }
+  
+  free(batch);
+  catalog_stream_close(st);
+  
+  return nrows;
+}
+
+
+/* Functions for writing n catalog_lib / catalog_mmt / catalog_tui records
+   to filename in the layouts their readers take.  Rows are formatted with
+   the integer number formatters into a CATALOG_WRITE_BUF-byte buffer that
+   is flushed with large write() calls.                                 */
+void catalog_write_lib(char *filename, const catalog_lib *objects, int n){
+  
+  /* Variable Declarations */
+  int i;
+  catalog_out out;
+  
+  catalog_out_open(&out, filename);
+  for(i=0; i<n; i++)
+    out.fill = catalog_format_lib_line(catalog_out_reserve(&out,
+							   CATALOG_LIB_LINE),
+				       &objects[i]) - out.buf;
+  catalog_out_close(&out);
+  
+  return;
+}
+
+void catalog_write_mmt(char *filename, const catalog_mmt *objects, int n){
+  
+  /* Variable Declarations */
+  int i;
+  catalog_out out;
+  
+  catalog_out_open(&out, filename);
+  for(i=0; i<n; i++)
+    out.fill = catalog_format_mmt_line(catalog_out_reserve(&out, 256),
+				       &objects[i]) - out.buf;
+  catalog_out_close(&out);
+  
+  return;
+}
+
+void catalog_write_tui(char *filename, const catalog_tui *objects, int n){
+  
+  /* Variable Declarations */
+  int i;
+  catalog_out out;
+  
+  catalog_out_open(&out, filename);
+  for(i=0; i<n; i++)
+    out.fill = catalog_format_tui_line(catalog_out_reserve(&out, 256),
+				       &objects[i]) - out.buf;
+  catalog_out_close(&out);
+  
+  return;
+}
+
+
+/* Function for writing n catalog_lib records through a memory map of the
+   output file:  lib lines are fixed width, so the file is sized up front
+   and row ranges are formatted straight into it by nthreads threads
+   (<= 0 uses all cores).                                               */
+void catalog_write_lib_mmap(char *filename, const catalog_lib *objects, int n,
+			    int nthreads){
+  
+  /* Variable Declarations */
+  int fd,k,chunk;
+  size_t len;
+  char *map;
+  catalog_write_work *work;
+  
+  len = (size_t)n * CATALOG_LIB_LINE;
+  if((fd=open(filename,O_RDWR|O_CREAT|O_TRUNC,0644)) < 0 ||
+     ftruncate(fd,len) < 0){
+    fprintf(stderr,"\nError opening file %s\n",filename);
+    exit(1);
+  }
+  if(len == 0){
+    close(fd);
+    return;
+  }
+  map = (char *)mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED){
+    fprintf(stderr,"\nError mapping file %s\n",filename);
+    exit(1);
+  }
+  
+  /* One contiguous range of rows per thread */
+  nthreads = parallel_nthreads(nthreads);
+  if(nthreads > n)
+    nthreads = n;
+  chunk = (n + nthreads - 1) / nthreads;
+  
+  work = (catalog_write_work *)malloc(nthreads * sizeof(catalog_write_work));
+  for(k=0; k<nthreads; k++){
+    work[k].map     = map;
+    work[k].objects = objects;
+    work[k].first   = k * chunk;
+    work[k].last    = ((k + 1) * chunk < n) ? (k + 1) * chunk : n;
+  }
+  parallel_run(nthreads, catalog_write_worker, work,
+	       sizeof(catalog_write_work));
+  
+  free(work);
+  munmap(map, len);
+  
+  return;
+}
+
+
+/* Line parser adapters for parallel_parse_file() */
+static int catalog_lib_line(const char *line, size_t len, void *rec){
+  return catalog_parse_lib_line(line, len, (catalog_lib *)rec);
+}
+
+static int catalog_mmt_line(const char *line, size_t len, void *rec){
+  return catalog_parse_mmt_line(line, len, (catalog_mmt *)rec);
+}
+
+static int catalog_tui_line(const char *line, size_t len, void *rec){
+  return catalog_parse_tui_line(line, len, (catalog_tui *)rec);
+}
+
+static int catalog_obs_line(const char *line, size_t len, void *rec){
+  return astrom_parse_observatory(line, len, (astrom_location *)rec);
+}
+
+
+/* Function to split a len-character line at blanks into up to maxtok
+   null-terminated tokens (each cut to 31 characters).  Returns the
+   number of tokens found.                                              */
+static int catalog_tokens(const char *line, size_t len, char tok[][32],
+			  int maxtok){
+  
+  /* Variable Declarations */
+  int ntok=0;
+  size_t i=0,k;
+  
+  while(ntok < maxtok){
+    while(i < len && (line[i] == ' ' || line[i] == '\t' ||
+		      line[i] == '\r' || line[i] == '\n'))
+      i++;
+    if(i >= len)
+      break;
+    for(k=0; i < len && line[i] != ' ' && line[i] != '\t' &&
+	  line[i] != '\r' && line[i] != '\n'; i++)
+      if(k < 31)
+	tok[ntok][k++] = line[i];
+    tok[ntok++][k] = '\0';
+  }
+  
+  return ntok;
+}
+
+
+/* Function returning how much of the field [start, start+width) lies
+   within a len-character line */
+static size_t catalog_field_width(size_t len, size_t start, size_t width){
+  
+  if(start >= len)
+    return 0;
+  
+  return (start + width > len) ? len - start : width;
+}
+
+
+/* Function to copy the field [start, start+width) of a len-character line
+   into dst (at least width+1 bytes) as a null-terminated string; fields
+   past the end of a short line come back empty */
+static void catalog_field_copy(char *dst, const char *line, size_t len,
+			       size_t start, size_t width){
+  
+  width = catalog_field_width(len, start, width);
+  
+  memcpy(dst, line + start, width);
+  dst[width] = '\0';
+  
+  return;
+}
+
+
+/* Function to count the rows among n whose RA or Dec is not finite, i.e.
+   did not scan; ra & dec step by stride bytes, so both record arrays &
+   columns can be passed */
+static int catalog_count_bad(const double *ra, const double *dec, int n,
+			     size_t stride){
+  
+  /* Variable Declarations */
+  int i,nbad=0;
+  
+  for(i=0; i<n; i++){
+    if(!isfinite(*ra) || !isfinite(*dec))
+      nbad++;
+    ra  = (const double *)((const char *)ra + stride);
+    dec = (const double *)((const char *)dec + stride);
+  }
+  
+  return nbad;
+}
+
+
+/* Function to print the entry count of a catalog just read, with the
+   number of rows (if any) that were kept without a valid position */
+static void catalog_report(const char *filename, int n, int nbad){
+  
+  if(nbad > 0)
+    printf("Catalog %s has %d entries, %d without a valid position.\n",
+	   filename,n,nbad);
+  else
+    printf("Catalog %s has %d entries.\n",filename,n);
+  
+  return;
+}
+
+
+/* Function to allocate an n-row columnar catalog with an empty pool */
+static catalog_soa *catalog_soa_alloc(int n, int format){
+  
+  /* Variable Declarations */
+  size_t m = (n > 0) ? n : 1;
+  catalog_soa *cat;
+  
+  cat = (catalog_soa *)calloc(1, sizeof(catalog_soa));
+  cat->n       = n;
+  cat->format  = format;
+  cat->ra      = (double *)malloc(m * sizeof(double));
+  cat->dec     = (double *)malloc(m * sizeof(double));
+  cat->epoch   = (double *)malloc(m * sizeof(double));
+  cat->ra_pm   = (float *)malloc(m * sizeof(float));
+  cat->dec_pm  = (float *)malloc(m * sizeof(float));
+  cat->mag     = (float *)malloc(m * sizeof(float));
+  cat->color   = (float *)malloc(m * sizeof(float));
+  cat->pa      = (float *)malloc(m * sizeof(float));
+  cat->id      = (unsigned int *)malloc(m * sizeof(unsigned int));
+  cat->spectyp = (unsigned int *)malloc(m * sizeof(unsigned int));
+  
+  // Offset 0 of the pool is always the empty string
+  cat->pool     = (char *)calloc(1, sizeof(char));
+  cat->poolsize = 1;
+  
+  return cat;
+}
+
+
+/* Function to intern str in the string pool of cat & return its offset:
+   a string already in the pool is shared rather than stored again */
+static unsigned int catalog_pool_add(catalog_soa *cat, const char *str,
+				     catalog_pool *pool){
+  
+  /* Variable Declarations */
+  size_t i,h,len,off,nold;
+  unsigned int *old;
+  
+  len = strlen(str);
+  if(len == 0)
+    return 0;
+  
+  /* Keep the table at most half full */
+  if(2 * (pool->nused + 1) > pool->nslot){
+    old  = pool->slot;
+    nold = pool->nslot;
+    pool->nslot = (nold) ? 2 * nold : 1024;
+    pool->slot  = (unsigned int *)calloc(pool->nslot, sizeof(unsigned int));
+    for(i=0; i<nold; i++){
+      if(old[i] == 0)
+	continue;
+      h = catalog_pool_hash(cat->pool + old[i]) & (pool->nslot - 1);
+      while(pool->slot[h] != 0)
+	h = (h + 1) & (pool->nslot - 1);
+      pool->slot[h] = old[i];
+    }
+    free(old);
+  }
+  
+  /* Already interned? */
+  h = catalog_pool_hash(str) & (pool->nslot - 1);
+  while(pool->slot[h] != 0){
+    if(!strcmp(cat->pool + pool->slot[h], str))
+      return pool->slot[h];
+    h = (h + 1) & (pool->nslot - 1);
+  }
+  
+  /* Append */
+  if(cat->poolsize + len + 1 > pool->alloc){
+    pool->alloc = 2 * (cat->poolsize + len + 1) + 4096;
+    cat->pool = (char *)realloc(cat->pool, pool->alloc);
+  }
+  off = cat->poolsize;
+  memcpy(cat->pool + off, str, len + 1);
+  cat->poolsize += len + 1;
+  
+  pool->slot[h] = (unsigned int)off;
+  pool->nused++;
+  
+  return (unsigned int)off;
+}
+
+
+/* Function to drop the interning table & trim the pool to size */
+static void catalog_pool_done(catalog_soa *cat, catalog_pool *pool){
+  
+  free(pool->slot);
+  cat->pool = (char *)realloc(cat->pool, cat->poolsize);
+  
+  return;
+}
+
+
+/* FNV-1a hash of a null-terminated string */
+static unsigned int catalog_pool_hash(const char *str){
+  
+  unsigned int h = 2166136261u;
+  
+  while(*str)
+    h = (h ^ (unsigned char)*str++) * 16777619u;
+  
+  return h;
+}
+
+
+/* Function to list the column pointers of cat, in cache file order */
+static void catalog_soa_columns(const catalog_soa *cat, void *cols[]){
+  
+  cols[0]  = cat->ra;
+  cols[1]  = cat->dec;
+  cols[2]  = cat->epoch;
+  cols[3]  = cat->ra_pm;
+  cols[4]  = cat->dec_pm;
+  cols[5]  = cat->mag;
+  cols[6]  = cat->color;
+  cols[7]  = cat->pa;
+  cols[8]  = cat->id;
+  cols[9]  = cat->spectyp;
+  cols[10] = cat->pool;
+  
+  return;
+}
+
+
+/* Function to format one Master Catalog line (CATALOG_LIB_LINE bytes,
+   with the newline) at p, laid out as catalog_parse_lib_line() reads it.
+   Returns the position after the line.                                */
+static char *catalog_format_lib_line(char *p, const catalog_lib *rec){
+  
+  /* Variable Declarations */
+  char field[COORD_FMT_LEN];
+  
+  p = strings_put_padded(p, rec->id, 15);
+  catalog_put_dms(field, rec->ra, COORD_RA, 3);
+  p = strings_put_padded(p, field, 15);
+  catalog_put_dms(field, rec->dec, COORD_DEC, 2);
+  p = strings_put_padded(p, field, 15);
+  p = strings_put_fixed(p, rec->ra_pm, 5, 2);
+  p = strings_put_fixed(p, rec->dec_pm, 5, 2);
+  p = strings_put_fixed(p, rec->mag, 10, 3);
+  p = strings_put_fixed(p, rec->color, 10, 3);
+  p = strings_put_padded(p, rec->spectyp, 10);
+  p = strings_put_fixed(p, rec->epoch, 10, 2);
+  p = strings_put_fixed(p, rec->pa, 10, 2);
+  *p++ = '\n';
+  
+  return p;
+}
+
+
+/* Function to format one MMT-style catalog line at p:  blank-separated
+   fields, with blanks in the id & spectral type turned into '_' (an empty
+   spectral type is written as '-').  Returns the position after it. */
+static char *catalog_format_mmt_line(char *p, const catalog_mmt *rec){
+  
+  p = catalog_put_token(p, rec->id, 14, 49);
+  *p++ = ' ';
+  p = catalog_put_dms(p, rec->ra, COORD_RA, 3);
+  *p++ = ' ';
+  p = catalog_put_dms(p, rec->dec, COORD_DEC, 2);
+  *p++ = ' ';
+  p = strings_put_fixed(p, rec->ra_pm, 8, 4);
+  *p++ = ' ';
+  p = strings_put_fixed(p, rec->dec_pm, 8, 3);
+  *p++ = ' ';
+  p = strings_put_fixed(p, rec->mag, 6, 2);
+  *p++ = ' ';
+  p = catalog_put_token(p, rec->spectyp, 0, 49);
+  *p++ = ' ';
+  if(rec->epoch == 2000.){
+    memcpy(p, "J2000.0", 7);
+    p += 7;
+  }
+  else if(rec->epoch == 1950.){
+    memcpy(p, "B1950.0", 7);
+    p += 7;
+  }
+  else
+    p = strings_put_fixed(p, rec->epoch, 6, 1);
+  *p++ = '\n';
+  
+  return p;
+}
+
+
+/* Function to format one TUI catalog line at p:  the quoted name, RA,
+   Dec & the keyword=value list.  Returns the position after it.     */
+static char *catalog_format_tui_line(char *p, const catalog_tui *rec){
+  
+  /* Variable Declarations */
+  int i;
+  
+  *p++ = '"';
+  for(i=0; i<49 && rec->id[i] != '\0'; i++)
+    *p++ = (rec->id[i] == '"') ? '\'' : rec->id[i];
+  *p++ = '"';
+  *p++ = ' ';
+  p = catalog_put_dms(p, rec->ra, COORD_RA, 2);
+  *p++ = ' ';
+  p = catalog_put_dms(p, rec->dec, COORD_DEC, 1);
+  for(i=0; i<99 && rec->keywords[i] != '\0' && rec->keywords[i] != '\n';
+      i++){
+    if(i == 0)
+      *p++ = ' ';
+    *p++ = rec->keywords[i];
+  }
+  *p++ = '\n';
+  
+  return p;
+}
+
+
+/* Function to write one coordinate with coord_format_dms() at p (room
+   for COORD_FMT_LEN bytes), or "nan" -- which the readers take back as
+   NAN -- if the value cannot be formatted (NAN, Inf or too large).  The field is null-terminated;
+   returns the position of the null.                                    */
+static char *catalog_put_dms(char *p, double deg, int c_type, int ndigits){
+  
+  /* Variable Declarations */
+  int len;
+  
+  len = coord_format_dms(deg, c_type, ndigits, p, COORD_FMT_LEN);
+  if(len < 0){
+    memcpy(p, "nan", 4);
+    len = 3;
+  }
+  
+  return p + len;
+}
+
+
+/* Function to write str (at most maxlen characters, trailing blanks
+   dropped) as a single blank-free token, padded with blanks to width.
+   Returns the position after it.                                    */
+static char *catalog_put_token(char *p, const char *str, int width,
+			       int maxlen){
+  
+  /* Variable Declarations */
+  int i,len;
+  
+  for(len=0; len<maxlen && str[len] != '\0'; len++);
+  while(len > 0 && (str[len-1] == ' ' || str[len-1] == '\t'))
+    len--;
+  
+  for(i=0; i<len; i++)
+    p[i] = (str[i] == ' ' || str[i] == '\t') ? '_' : str[i];
+  if(i == 0)
+    p[i++] = '-';
+  for(; i<width; i++)
+    p[i] = ' ';
+  
+  return p + i;
+}
+
+
+/* Function to create filename for one of the buffered writers */
+static void catalog_out_open(catalog_out *out, char *filename){
+  
+  if((out->fd=open(filename,O_WRONLY|O_CREAT|O_TRUNC,0644)) < 0){
+    fprintf(stderr,"\nError opening file %s\n",filename);
+    exit(1);
+  }
+  out->name = filename;
+  out->buf  = (char *)malloc(CATALOG_WRITE_BUF);
+  out->fill = 0;
+  
+  return;
+}
+
+
+/* Function returning where the next need bytes can be formatted, after
+   flushing the buffer if they would not fit */
+static char *catalog_out_reserve(catalog_out *out, size_t need){
+  
+  if(out->fill + need > CATALOG_WRITE_BUF)
+    catalog_out_flush(out);
+  
+  return out->buf + out->fill;
+}
+
+
+/* Function to write out the buffer, all of it */
+static void catalog_out_flush(catalog_out *out){
+  
+  /* Variable Declarations */
+  size_t done=0;
+  ssize_t w;
+  
+  while(done < out->fill){
+    w = write(out->fd, out->buf + done, out->fill - done);
+    if(w < 0 && errno == EINTR)
+      continue;
+    if(w <= 0){
+      fprintf(stderr,"\nError writing file %s\n",out->name);
+      exit(1);
+    }
+    done += w;
+  }
+  out->fill = 0;
+  
+  return;
+}
+
+
+/* Function to flush & close a buffered writer */
+static void catalog_out_close(catalog_out *out){
+  
+  catalog_out_flush(out);
+  if(close(out->fd) < 0){
+    fprintf(stderr,"\nError writing file %s\n",out->name);
+    exit(1);
+  }
+  free(out->buf);
+  
+  return;
+}
+
+
+/* Worker for catalog_write_lib_mmap(): format one range of rows in place */
+static void *catalog_write_worker(void *arg){
+  
+  /* Variable Declarations */
+  int i;
+  catalog_write_work *w = (catalog_write_work *)arg;
+  
+  for(i=w->first; i<w->last; i++)
+    catalog_format_lib_line(w->map + (size_t)i * CATALOG_LIB_LINE,
+			    &w->objects[i]);
+  
+  return NULL;
+}
@@ -11,37 +11,60 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
 
 #include <tpeb.h>
 
+#define COORD_MAXTOK 6   // Numeric fields in an RA / Dec pair
+#define COORD_NUM_LEN 64 // Longest numeric field passed to strtod()
+
+// One numeric field found by coord_scan_fields()
+typedef struct {
+  double val;
+  int    isint;         // No decimal point
+  int    sign;          // -1, +1 if signed, 0 if not
+  int    colon;         // Followed by ':'
+} coord_field;
+
+static int coord_scan_fields(const char *str, size_t len, coord_field *f,
+			     int *nf);
+static int coord_field_value(const coord_field *f, int nf, int c_type,
+			     int decimal, double *deg);
+static char *coord_put_int(char *p, long long val, int width);
+static int   coord_put_dms(double deg, int c_type, int ndigits, char *buf,
+			   size_t buflen);
+
 
 /* Function to parse out RA & Dec from string input
    Form of algorithm from Phil Pinto, UA, 1999) 
    --Modified 10/22/09 to return astrom_coord structure
    containing the ddd.ddddddd versions of the parsed
-   coordinates  */
+   coordinates
+   --Uses strtok_r() so it may be called from several threads at once */
 astrom_coords coord_parserd(char line[128]){
   
-  char *ratok, *dectok, line2[128];
+  char *ratok, *dectok, line2[128], *save, *fsave;
   double rdout[2][3];
   astrom_coords object;
 
   strcpy(line2,line);
   
   /* get RA and DEC */
-  ratok = strtok(line2," ");
-  dectok = strtok( (char *) NULL, " ");
+  ratok = strtok_r(line2," ",&save);
+  dectok = strtok_r( (char *) NULL, " ",&save);
   
   /* parse RA */
-  rdout[0][0] = atoi(strtok(ratok,":"));
-  rdout[0][1] = atoi(strtok((char *) NULL,":"));
-  rdout[0][2] = atof(strtok((char *) NULL," "));
+  rdout[0][0] = atoi(strtok_r(ratok,":",&fsave));
+  rdout[0][1] = atoi(strtok_r((char *) NULL,":",&fsave));
+  rdout[0][2] = atof(strtok_r((char *) NULL," ",&fsave));
   
-  /* parse DEC */
-  rdout[1][0] = atoi(strtok(dectok,":"));
-  rdout[1][1] = atoi(strtok((char *) NULL,":"));
-  rdout[1][2] = atof(strtok((char *) NULL," "));
+  /* parse DEC (keeping the sign of "-00" as -0.) */
+  rdout[1][0] = atoi(strtok_r(dectok,":",&fsave));
+  if(dectok[0] == '-')
+    rdout[1][0] = -fabs(rdout[1][0]);
+  rdout[1][1] = atoi(strtok_r((char *) NULL,":",&fsave));
+  rdout[1][2] = atof(strtok_r((char *) NULL," ",&fsave));
   
   /* Check to ensure proper values for coordinates */
   if(rdout[0][0] > 23 || rdout[0][0] < 0)
@@ -73,17 +96,16 @@ double coord_dmstodeg(double dms[3], int c_type){
   double degout;
   int sign;
   
-  /* Taking precautions if value is less than zero */
-  if(dms[0] < 0.){
+  /* Taking precautions if value is less than zero (the input array is
+     left untouched, so it may be shared between threads) */
+  if(signbit(dms[0]))
     sign = -1;
-    dms[0] = -dms[0];
-  }
   else sign = 1;
 
   if(c_type == COORD_DEC)
-    degout = sign*(dms[0]+(dms[1]/60.)+(dms[2]/3600.));
+    degout = sign*(fabs(dms[0])+(dms[1]/60.)+(dms[2]/3600.));
   else
-    degout = sign*(dms[0]+(dms[1]/60.)+(dms[2]/3600.)) * 15.;
+    degout = sign*(fabs(dms[0])+(dms[1]/60.)+(dms[2]/3600.)) * 15.;
     
   return degout;
 }
@@ -95,34 +117,416 @@ double coord_dmstodeg(double dms[3], int c_type){
    this routine! */
 void coord_degtodms(double deg, char *dms_str, int c_type){
 
-  /* Variable Declarations */
-  int neg = 1;
-  float  dms[3];
-  double temp[3];
+  /* Same layouts as always (RA to 0.01s, Dec & LST to 0.1), now through
+     the integer formatter so 59.99 rounds up into the next minute */
+  if(coord_format_dms(deg, c_type, -1, dms_str, COORD_FMT_LEN) < 0)
+    dms_str[0] = '\0';
+  
+  return;
+}
+
 
-  if(c_type == COORD_RA || c_type == COORD_LST)
-    deg /= 15.;
+/* Function to write deg as a colon-delimited string into buf (buflen
+   bytes):  COORD_RA & COORD_LST as HH:MM:SS.s (RA in ddd.dddddd format,
+   wrapped to 0-24h), COORD_DEC as +DD:MM:SS.s.  ndigits (0-9) decimals on
+   the seconds, or < 0 for the coord_degtodms() defaults (RA 2, Dec & LST
+   1).  The value is rounded once, to an integer count of the last digit,
+   and split with integer arithmetic, so the carry runs through minutes &
+   degrees (never 60 seconds).  Returns the length written, or -1 if buf
+   is too small, or deg is not finite or too large to be counted in the
+   last digit (so a NAN position never comes out as 00:00:00).        */
+int coord_format_dms(double deg, int c_type, int ndigits, char *buf,
+		     size_t buflen){
+  
+  /* Variable Declarations */
+  int i,neg=0,len;
+  long long unit,ticks,secs,hd;
+  char *p;
   
-  /* Dealing with negative signs */
-  if(deg < 0){
+  if(ndigits < 0)
+    ndigits = (c_type == COORD_RA) ? 2 : 1;
+  if(ndigits > 9)
+    ndigits = 9;
+  if(!isfinite(deg))
+    return -1;
+  
+  for(unit=1, i=0; i<ndigits; i++)
+    unit *= 10;
+  
+  if(c_type == COORD_RA || c_type == COORD_LST){
+    deg = fmod(deg / 15., 24.);
+    if(deg < 0.)
+      deg += 24.;
+  }
+  else if(deg < 0.){
     deg = -deg;
-    neg = -1;
+    neg = 1;
   }
   
-  temp[0] = deg;
-  dms[0] = neg * floor(temp[0]);
-  temp[1] = (temp[0] - fabs(dms[0]))*60.;
-  dms[1] = floor(temp[1]);
-  temp[2] = (temp[1] - dms[1])*60.;
-  dms[2] = (float)(temp[2]);
+  /* One rounding, in units of the last decimal of the seconds */
+  if(deg * 3600. * (double)unit >= (double)LLONG_MAX)
+    return -1;
+  ticks = llround(deg * 3600. * (double)unit);
+  if(c_type != COORD_DEC && ticks >= 86400LL * unit)
+    ticks -= 86400LL * unit;
+  secs = ticks / unit;
   
+  // Length, allowing for a (bad) Dec of 100 degrees or more
+  len = ((c_type == COORD_DEC) ? 9 : 8) + ((ndigits) ? ndigits + 1 : 0);
+  for(hd=secs/3600; hd >= 100; hd /= 10)
+    len++;
+  if(buflen < (size_t)len + 1)
+    return -1;
+  
+  p = buf;
   if(c_type == COORD_DEC)
-    sprintf(dms_str,"%+03.0f:%02.0f:%04.1f",dms[0],dms[1],dms[2]);
-  else if(c_type == COORD_RA)
-    sprintf(dms_str,"%02.0f:%02.0f:%05.2f",dms[0],dms[1],dms[2]);
-  else if(c_type == COORD_LST)
-    sprintf(dms_str,"%02.0f:%02.0f:%04.1f",dms[0],dms[1],dms[2]);
+    *p++ = (neg) ? '-' : '+';
+  p = coord_put_int(p, secs / 3600, 2);
+  *p++ = ':';
+  p = coord_put_int(p, (secs / 60) % 60, 2);
+  *p++ = ':';
+  p = coord_put_int(p, secs % 60, 2);
+  if(ndigits){
+    *p++ = '.';
+    p = coord_put_int(p, ticks % unit, ndigits);
+  }
+  *p = '\0';
   
+  return (int)(p - buf);
+}
+
+
+/* Function to format n values (see coord_format_dms()) into one buffer,
+   each followed by the separator character sep.  Values that cannot be
+   formatted (NAN, or too large) are written as "nan".  Returns the number
+   of bytes written (not counting the final null), or -1 if buf is too
+   small.                                                               */
+long coord_format_dms_array(const double *deg, int n, int c_type,
+			    int ndigits, char sep, char *buf, size_t buflen){
   
-  return;
+  /* Variable Declarations */
+  int i,len;
+  size_t pos=0;
+  
+  for(i=0; i<n; i++){
+    len = coord_put_dms(deg[i], c_type, ndigits, buf + pos, buflen - pos);
+    if(len < 0 || pos + len + 1 >= buflen)
+      return -1;
+    pos += len;
+    buf[pos++] = sep;
+  }
+  buf[pos] = '\0';
+  
+  return (long)pos;
+}
+
+
+/* Function to format n RA / Dec pairs (ddd.dddddd) into one buffer as
+   lines of "HH:MM:SS.ss +DD:MM:SS.s", with the coord_degtodms() default
+   precision ("nan" for a value that cannot be formatted).  Returns the
+   number of bytes written, or -1 if buf is too small.                 */
+long coord_format_rd_array(const double *ra, const double *dec, int n,
+			   char *buf, size_t buflen){
+  
+  /* Variable Declarations */
+  int i,len;
+  size_t pos=0;
+  
+  for(i=0; i<n; i++){
+    len = coord_put_dms(ra[i], COORD_RA, -1, buf + pos, buflen - pos);
+    if(len < 0 || pos + len + 1 >= buflen)
+      return -1;
+    pos += len;
+    buf[pos++] = ' ';
+    
+    len = coord_put_dms(dec[i], COORD_DEC, -1, buf + pos, buflen - pos);
+    if(len < 0 || pos + len + 1 >= buflen)
+      return -1;
+    pos += len;
+    buf[pos++] = '\n';
+  }
+  buf[pos] = '\0';
+  
+  return (long)pos;
+}
+
+
+/* Function to scan an RA / Dec pair from str (len characters, or up to a
+   null) in one pass, with no copies or allocation.  Accepted forms:
+      HH:MM:SS.ss +DD:MM:SS.s      (also HH:MM.m, or a bare field)
+      HH MM SS.ss +DD MM SS.s      (or HH MM.m DD MM.m)
+      ddd.dddd +dd.dddd            (decimal degrees for both)
+   A sign on '-00' degrees is honored.  Results are in ddd.dddddd format.
+   Returns COORD_OK; COORD_ERANGE if a field is out of range (the value is
+   still returned); COORD_ESYNTAX if the text is not a coordinate pair
+   (ra & dec are set to NAN).                                          */
+int coord_scan_rd(const char *str, size_t len, astrom_coords *object){
+  
+  /* Variable Declarations */
+  int i,nf,nra,colon=0,decimal=0,st1,st2;
+  coord_field f[COORD_MAXTOK];
+  
+  object->ra = object->dec = NAN;
+  if(coord_scan_fields(str, len, f, &nf) != COORD_OK)
+    return COORD_ESYNTAX;
+  
+  /* Split the fields into the RA & Dec groups */
+  for(i=0; i<nf; i++)
+    colon |= f[i].colon;
+  
+  if(colon){
+    // Groups end at the first field not followed by ':'
+    for(nra=1; nra<nf && f[nra-1].colon; nra++);
+  }
+  else if(nf == 2){
+    nra = 1;
+    decimal = 1;
+  }
+  else if(nf == 4 || nf == 6)
+    nra = nf / 2;
+  else
+    return COORD_ESYNTAX;
+  
+  if(nra > 3 || nf - nra < 1 || nf - nra > 3)
+    return COORD_ESYNTAX;
+  for(i=nra+1; i<nf; i++)
+    if(!f[i-1].colon && colon)
+      return COORD_ESYNTAX;
+  
+  st1 = coord_field_value(f, nra, COORD_RA, decimal, &object->ra);
+  st2 = coord_field_value(f + nra, nf - nra, COORD_DEC, decimal,
+			  &object->dec);
+  if(st1 == COORD_ESYNTAX || st2 == COORD_ESYNTAX){
+    object->ra = object->dec = NAN;
+    return COORD_ESYNTAX;
+  }
+  
+  return (st1 != COORD_OK) ? st1 : st2;
+}
+
+
+/* Function to scan a single sexagesimal angle, DD:MM:SS.s or DD MM SS.s
+   (or fewer fields), from str (len characters, or up to a null) into
+   decimal degrees.  For c_type COORD_RA or COORD_LST the fields are
+   hours.  Returns COORD_OK, COORD_ERANGE or COORD_ESYNTAX (*deg = NAN),
+   as coord_scan_rd().                                                 */
+int coord_scan_angle(const char *str, size_t len, int c_type, double *deg){
+  
+  /* Variable Declarations */
+  int i,nf,st;
+  coord_field f[COORD_MAXTOK];
+  
+  *deg = NAN;
+  if(coord_scan_fields(str, len, f, &nf) != COORD_OK || nf > 3)
+    return COORD_ESYNTAX;
+  for(i=1; i<nf; i++)
+    if(f[0].colon != f[i-1].colon)
+      return COORD_ESYNTAX;
+  
+  st = coord_field_value(f, nf, c_type, 0, deg);
+  if(st == COORD_ESYNTAX)
+    *deg = NAN;
+  
+  return st;
+}
+
+
+/* Function to scan n null-terminated RA / Dec strings with
+   coord_scan_rd().  status (may be NULL) receives each return code.
+   Returns the number of strings that were not COORD_OK.               */
+int coord_scan_rd_array(const char **str, int n, astrom_coords *object,
+			int *status){
+  
+  /* Variable Declarations */
+  int i,st,nbad=0;
+  
+  for(i=0; i<n; i++){
+    st = coord_scan_rd(str[i], (size_t)-1, &object[i]);
+    if(status != NULL)
+      status[i] = st;
+    nbad += (st != COORD_OK);
+  }
+  
+  return nbad;
+}
+
+
+/* Function to split str into up to COORD_MAXTOK unsigned decimal fields,
+   noting a leading sign & whether each is followed by ':'.  Blanks, tabs
+   & line ends separate fields.  Returns COORD_OK or COORD_ESYNTAX.   */
+static int coord_scan_fields(const char *str, size_t len, coord_field *f,
+			     int *nf){
+  
+  /* Variable Declarations */
+  int k,ndig,seen,slow;
+  long long mant;
+  char num[COORD_NUM_LEN];
+  const char *p,*q,*end;
+  static const double pow10[19] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,
+				   1e10,1e11,1e12,1e13,1e14,1e15,1e16,1e17,
+				   1e18};
+  
+  /* Find the end of the text */
+  for(end=str; (size_t)(end - str) < len && *end != '\0'; end++);
+  
+  *nf = 0;
+  p = str;
+  while(1){
+    
+    // Blanks between fields (none after a ':')
+    if(*nf == 0 || !f[*nf-1].colon)
+      while(p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+	p++;
+    if(p == end){
+      if(*nf > 0 && f[*nf-1].colon)
+	return COORD_ESYNTAX;
+      break;
+    }
+    if(*nf == COORD_MAXTOK)
+      return COORD_ESYNTAX;
+    
+    f[*nf].sign = 0;
+    if(*p == '+' || *p == '-'){
+      f[*nf].sign = (*p == '-') ? -1 : 1;
+      p++;
+    }
+    
+    // Digits, with an optional decimal point, as an integer mantissa over
+    // a power of ten.  Up to 15 significant digits both are exact, so the
+    // one rounding matches strtod(); longer numbers are left to strtod()
+    mant = 0;
+    ndig = seen = slow = 0;
+    k    = -1;
+    for(q=p; p < end; p++){
+      if(*p >= '0' && *p <= '9'){
+	if(!slow){
+	  mant = 10 * mant + (*p - '0');
+	  if(mant) ndig++;
+	  if(k >= 0) k++;
+	  slow = (ndig > 15 || k > 18);
+	}
+	seen = 1;
+      }
+      else if(*p == '.' && k < 0)
+	k = 0;
+      else
+	break;
+    }
+    if(!seen)
+      return COORD_ESYNTAX;
+    
+    f[*nf].isint = (k < 0);
+    if(!slow)                 // k <= 18 here
+      f[*nf].val = (k > 0) ? (double)mant / pow10[k] : (double)mant;
+    else{
+      if(p - q >= COORD_NUM_LEN)
+	return COORD_ESYNTAX;
+      memcpy(num, q, p - q);
+      num[p - q] = '\0';
+      f[*nf].val = strtod(num, NULL);
+    }
+    f[*nf].colon = 0;
+    
+    // What may follow a field:  ':', a blank or the end
+    if(p < end && *p == ':'){
+      f[*nf].colon = 1;
+      p++;
+    }
+    else if(p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+      return COORD_ESYNTAX;
+    (*nf)++;
+  }
+  
+  return (*nf > 0) ? COORD_OK : COORD_ESYNTAX;
+}
+
+
+/* Function to combine the nf (1-3) fields of one angle into decimal
+   degrees, as coord_dmstodeg() does.  Only the first field may carry a
+   sign and only the last may have decimals.  decimal means a single
+   field in degrees (even for RA).  Returns COORD_OK, COORD_ERANGE or
+   COORD_ESYNTAX.                                                      */
+static int coord_field_value(const coord_field *f, int nf, int c_type,
+			     int decimal, double *deg){
+  
+  /* Variable Declarations */
+  int i,sign,range=COORD_OK;
+  double dms[3] = {0.,0.,0.};
+  
+  if(nf < 1 || nf > 3)
+    return COORD_ESYNTAX;
+  for(i=0; i<nf; i++){
+    if((i > 0 && f[i].sign) || (i < nf - 1 && !f[i].isint))
+      return COORD_ESYNTAX;
+    dms[i] = f[i].val;
+  }
+  sign = (f[0].sign < 0) ? -1 : 1;
+  
+  /* Field ranges, as checked by coord_parserd() (minutes may carry
+     decimals when they are the last field, so the limit is 60) */
+  if(dms[1] >= 60. || dms[2] >= 60.)
+    range = COORD_ERANGE;
+  
+  if(c_type == COORD_DEC){
+    *deg = sign*(dms[0]+(dms[1]/60.)+(dms[2]/3600.));
+    if(dms[0] > 90. || fabs(*deg) > 90.)
+      range = COORD_ERANGE;
+  }
+  else if(decimal){
+    *deg = sign * dms[0];
+    if(sign < 0 || dms[0] >= 360.)
+      range = COORD_ERANGE;
+  }
+  else{
+    *deg = sign*(dms[0]+(dms[1]/60.)+(dms[2]/3600.)) * 15.;
+    if(sign < 0 || dms[0] > 23.)
+      range = COORD_ERANGE;
+  }
+  
+  return range;
+}
+
+
+/* Function to write one value for the array formatters:  as
+   coord_format_dms(), but a value it cannot format is written as "nan".
+   Returns the length written, or -1 only if buf is too small.         */
+static int coord_put_dms(double deg, int c_type, int ndigits, char *buf,
+			 size_t buflen){
+  
+  /* Variable Declarations */
+  int len;
+  char field[COORD_FMT_LEN + 8];    // Room for 9 decimals on any Dec
+  
+  len = coord_format_dms(deg, c_type, ndigits, field, sizeof(field));
+  if(len < 0){
+    strcpy(field, "nan");
+    len = 3;
+  }
+  if(buflen < (size_t)len + 1)
+    return -1;
+  memcpy(buf, field, len + 1);
+  
+  return len;
+}
+
+
+/* Function to write a non-negative integer as at least width digits,
+   zero-padded, & return the position after it (not terminated) */
+static char *coord_put_int(char *p, long long val, int width){
+  
+  /* Variable Declarations */
+  int i,nd;
+  long long v;
+  
+  for(nd=1, v=val; v >= 10; v /= 10)
+    nd++;
+  if(nd < width)
+    nd = width;
+  
+  for(i=nd-1; i>=0; i--){
+    p[i] = '0' + (char)(val % 10);
+    val /= 10;
+  }
+  
+  return p + nd;
 }
@@ -10,6 +10,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 FILE *fileopenr(char *filename){
 
@@ -71,6 +75,44 @@ FILE *fileopenwa(char *filename){
   return fp;
 }
 
+/* Map a whole file read-only into memory; its size goes in *len.  An empty
+   file gives NULL with *len = 0.  Release with fileunmap().  */
+char *filemapr(char *filename, size_t *len){
+
+  int fd;
+  char *map;
+  struct stat st;
+
+  if((fd=open(filename,O_RDONLY)) < 0 || fstat(fd,&st) < 0){
+    fprintf(stderr,"\nError opening file %s\n",filename);
+    exit(1);
+  }
+
+  *len = (size_t)st.st_size;
+  if(*len == 0){
+    close(fd);
+    return NULL;
+  }
+
+  map = (char *)mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED){
+    fprintf(stderr,"\nError mapping file %s\n",filename);
+    exit(1);
+  }
+  madvise(map, *len, MADV_SEQUENTIAL);
+
+  return map;
+}
+
+void fileunmap(char *map, size_t len){
+
+  if(map != NULL)
+    munmap(map, len);
+
+  return;
+}
+
 /* Create filename from existing root */
 void make_filename(char *infile, char *outfile, char *ext, char *suffix){
 
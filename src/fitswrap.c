@@ -18,6 +18,7 @@
    fitswrap_open_readwrite();       Open FITS file for reading and writing
    fitswrap_read2array();           Reads FITS (subsection) into an array
    fitswrap_write2file();           Writes array to FITS file
+   fitswrap_timestamp();            Date & time strings for DATE-MOD
 
 */
 
@@ -128,8 +129,6 @@ void fitswrap_write2file(char *fileout, char *copyhdr, double **array,
   long fpixel[2],naxes[2],bzero;
   char buf_date[FLEN_VALUE],buf_time[FLEN_VALUE],*mod_comm;
   fitsfile *fitsfp,*hdrfp;
-  time_t now;
-  struct tm *ptr;
   *status = 0;
 
   /* Open file from which header will be copied */
@@ -184,10 +183,7 @@ void fitswrap_write2file(char *fileout, char *copyhdr, double **array,
   }
   
   /* Add/modify keyword for date modified 'DATE-MOD' & 'TIME-MOD' */
-  time(&now);
-  ptr = localtime(&now);
-  strftime(buf_date, FLEN_VALUE, "%Y-%m-%d", ptr);
-  strftime(buf_time, FLEN_VALUE, "%H:%M:%S", ptr);
+  fitswrap_timestamp(time(NULL), buf_date, buf_time);
   fits_update_key(fitsfp, TSTRING, "DATE-MOD", buf_date, mod_comm, status);
   fits_update_key(fitsfp, TSTRING, "TIME-MOD", buf_time, NULL, status);
   
@@ -203,6 +199,23 @@ void fitswrap_write2file(char *fileout, char *copyhdr, double **array,
 }
 
 
+/* Function to write the local date (YYYY-MM-DD) & time (HH:MM:SS) of
+   now into buf_date & buf_time (FLEN_VALUE bytes each), as used for the
+   DATE-MOD & TIME-MOD keywords.  Uses localtime_r(), so it may be called
+   from several threads at once. */
+void fitswrap_timestamp(time_t now, char *buf_date, char *buf_time){
+  
+  /* Variable Declarations */
+  struct tm tm_now;
+  
+  localtime_r(&now, &tm_now);
+  strftime(buf_date, FLEN_VALUE, "%Y-%m-%d", &tm_now);
+  strftime(buf_time, FLEN_VALUE, "%H:%M:%S", &tm_now);
+  
+  return;
+}
+
+
 /* Function to catch errors thrown by CFITSIO */
 void fitswrap_catcherror(int *status){
   fits_report_error(stderr,*status);
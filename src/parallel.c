@@ -0,0 +1,218 @@
+/******** parallel.c ********/
+/* Timothy Ellsworth Bowers
+
+   Small fork-join helpers around POSIX threads, so that the array-based
+   library routines can split their work across cores without each one
+   handling thread creation itself.
+
+   Calling sequence:
+     nthreads = parallel_nthreads(requested);     -- <= 0 means all cores
+     parallel_run(nthreads, worker, args, sizeof(args[0]));
+
+   parallel_run() calls worker(&args[k]) for k = 0 .. nthreads-1, each on
+   its own thread (the first on the calling thread), and returns once all
+   of them have finished.
+
+     records = parallel_parse_file(filename, sizeof(rec), parse, nthreads, &n);
+
+   parallel_parse_file() (or _buffer() on text already in memory) splits
+   the text into newline-aligned chunks, one per thread, runs parse() on
+   every line that is not blank or a '#' comment, and returns the records
+   in file order in one malloc'd array.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <tpeb.h>
+
+#define PARALLEL_MIN_CHUNK 65536   // Smallest chunk worth its own thread
+
+// Per-thread block for parallel_parse_buffer()
+typedef struct {
+  const char *start;    // Chunk of the text, whole lines
+  const char *end;
+  size_t      recsize;
+  parallel_line_parser parse;
+  char       *recs;     // Records parsed from the chunk
+  int         n;
+  int         nalloc;
+} parallel_parse_work;
+
+static void *parallel_parse_worker(void *arg);
+
+
+/* Function that returns the number of threads to use for a request of
+   'requested' threads:  anything <= 0 means one per online processor */
+int parallel_nthreads(int requested){
+
+  /* Variable Declarations */
+  long ncpu;
+
+  if(requested > 0)
+    return (requested < PARALLEL_MAX_THREADS) ? requested :
+      PARALLEL_MAX_THREADS;
+
+  ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  if(ncpu < 1)
+    ncpu = 1;
+  if(ncpu > PARALLEL_MAX_THREADS)
+    ncpu = PARALLEL_MAX_THREADS;
+
+  return (int)ncpu;
+}
+
+
+/* Function to run worker() over nthreads argument blocks of argsize bytes
+   laid out contiguously at args, one thread per block.  Falls back to
+   running a block on the calling thread if a thread cannot be created. */
+void parallel_run(int nthreads, void *(*worker)(void *), void *args,
+		  size_t argsize){
+
+  /* Variable Declarations */
+  int i;
+  char *arg = (char *)args;
+  pthread_t tid[PARALLEL_MAX_THREADS];
+  int started[PARALLEL_MAX_THREADS];
+
+  if(nthreads > PARALLEL_MAX_THREADS)
+    nthreads = PARALLEL_MAX_THREADS;
+
+  /* Spawn threads for blocks 1 .. nthreads-1 */
+  for(i=1; i<nthreads; i++){
+    started[i] = (pthread_create(&tid[i], NULL, worker,
+				 arg + i * argsize) == 0);
+    if(!started[i])
+      worker(arg + i * argsize);
+  }
+
+  /* Block 0 runs here, then wait on the rest */
+  if(nthreads > 0)
+    worker(arg);
+
+  for(i=1; i<nthreads; i++)
+    if(started[i])
+      pthread_join(tid[i], NULL);
+
+  return;
+}
+
+
+/* Function to parse the len bytes of text at buf line by line with
+   parse(), nthreads chunks at a time (<= 0 uses all cores).  Blank lines
+   & lines starting with '#' are skipped.  Returns a malloc'd array of *n
+   records of recsize bytes, in the order they appear in the text.      */
+void *parallel_parse_buffer(const char *buf, size_t len, size_t recsize,
+			    parallel_line_parser parse, int nthreads, int *n){
+  
+  /* Variable Declarations */
+  int k,total;
+  size_t cut;
+  const char *nl;
+  char *out;
+  parallel_parse_work *work;
+  
+  /* No more threads than chunks of a useful size */
+  nthreads = parallel_nthreads(nthreads);
+  if((size_t)nthreads > len / PARALLEL_MIN_CHUNK + 1)
+    nthreads = (int)(len / PARALLEL_MIN_CHUNK + 1);
+  
+  /* Chunk boundaries, moved forward to the start of a line */
+  work = (parallel_parse_work *)calloc(nthreads, sizeof(parallel_parse_work));
+  for(k=0; k<nthreads; k++){
+    cut = (size_t)((double)len * k / nthreads);
+    if(cut > 0 && k > 0){
+      nl = (const char *)memchr(buf + cut - 1, '\n', len - cut + 1);
+      cut = (nl == NULL) ? len : (size_t)(nl - buf) + 1;
+    }
+    work[k].start   = buf + cut;
+    work[k].recsize = recsize;
+    work[k].parse   = parse;
+    if(k > 0)
+      work[k-1].end = work[k].start;
+  }
+  if(nthreads > 0)
+    work[nthreads-1].end = buf + len;
+  
+  parallel_run(nthreads, parallel_parse_worker, work,
+	       sizeof(parallel_parse_work));
+  
+  /* Stitch the chunks back together in order */
+  for(total=0, k=0; k<nthreads; k++)
+    total += work[k].n;
+  
+  if(nthreads == 1){
+    out = work[0].recs;
+    if(total > 0)
+      out = (char *)realloc(out, total * recsize);
+  }
+  else{
+    out = (char *)malloc((total > 0 ? total : 1) * recsize);
+    for(total=0, k=0; k<nthreads; k++){
+      if(work[k].n > 0)
+	memcpy(out + total * recsize, work[k].recs, work[k].n * recsize);
+      total += work[k].n;
+      free(work[k].recs);
+    }
+  }
+  
+  free(work);
+  *n = total;
+  
+  return (void *)out;
+}
+
+
+/* Function to map filename and parse it with parallel_parse_buffer() */
+void *parallel_parse_file(char *filename, size_t recsize,
+			  parallel_line_parser parse, int nthreads, int *n){
+  
+  /* Variable Declarations */
+  size_t maplen;
+  char *map;
+  void *recs;
+  
+  map  = filemapr(filename, &maplen);
+  recs = parallel_parse_buffer(map, maplen, recsize, parse, nthreads, n);
+  fileunmap(map, maplen);
+  
+  return recs;
+}
+
+
+/* Worker for parallel_parse_buffer(): parse one chunk into its own
+   growing record buffer */
+static void *parallel_parse_worker(void *arg){
+  
+  /* Variable Declarations */
+  parallel_parse_work *w = (parallel_parse_work *)arg;
+  const char *p,*eol;
+  
+  w->n      = 0;
+  w->nalloc = (int)((w->end - w->start) / 80) + 16;
+  w->recs   = (char *)malloc(w->nalloc * w->recsize);
+  
+  for(p=w->start; p < w->end; p=eol+1){
+    
+    eol = (const char *)memchr(p, '\n', w->end - p);
+    if(eol == NULL)
+      eol = w->end;
+    
+    // Skip comments & blank lines
+    if(*p == '#' || eol == p || (eol - p == 1 && *p == '\r'))
+      continue;
+    
+    if(w->n == w->nalloc){
+      w->nalloc *= 2;
+      w->recs = (char *)realloc(w->recs, w->nalloc * w->recsize);
+    }
+    if(w->parse(p, eol - p, w->recs + w->n * w->recsize))
+      w->n++;
+  }
+  
+  return NULL;
+}
@@ -0,0 +1,498 @@
+/******** skyindex.c ********/
+/* Timothy Ellsworth Bowers
+
+   Hierarchical spatial index over arrays of sky positions, for cone and
+   box searches that do not have to scan the whole catalog.
+
+   The sphere is partitioned with the Hierarchical Triangular Mesh (HTM;
+   Kunszt, Szalay & Thakar 2001):  eight root spherical triangles
+   (trixels) on the octahedron, each split into four children at every
+   level by joining the midpoints of its edges.  Every position is given
+   the ID of the leaf trixel holding it, and the positions are sorted by
+   that ID.  Since the IDs of all descendants of a trixel form one
+   contiguous range, any trixel at any level maps to a slice of the sorted
+   arrays found by binary search.
+
+   A search walks down the mesh from the roots, discarding trixels that
+   cannot touch the search region, taking whole slices for trixels that
+   lie entirely inside it, and testing individual positions only in leaf
+   trixels crossed by its edge -- so the cost follows the size of the
+   result rather than the size of the catalog.
+
+   Calling sequence:
+     index = skyindex_build_lib(catalog, n, SKYINDEX_DEPTH);
+     found = skyindex_cone(index, &center, radius, &nfound);  -- degrees
+     found = skyindex_box(index, ra_min, ra_max, dec_min, dec_max, &nfound);
+     .
+     .
+     free(found);
+     skyindex_free(index);
+
+   The returned arrays hold indices into the ORIGINAL catalog array, and
+   must be freed by the calling function.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <tpeb.h>
+
+#define SKYINDEX_EPS 1.e-12    // Slack on containment & overlap tests
+
+/* Vertices of the octahedron, and the eight root trixels built from them
+   (S0-S3 are IDs 8-11, N0-N3 are IDs 12-15)                             */
+static const double skyindex_vert[6][3] = {
+  { 0., 0., 1.}, { 1., 0., 0.}, { 0., 1., 0.},
+  {-1., 0., 0.}, { 0.,-1., 0.}, { 0., 0.,-1.} };
+
+static const int skyindex_root[8][3] = {
+  {1,5,2}, {2,5,3}, {3,5,4}, {4,5,1},      // S0 - S3
+  {1,0,4}, {4,0,3}, {3,0,2}, {2,0,1} };    // N0 - N3
+
+// Position ID / catalog index pair, for sorting at build time
+typedef struct {
+  unsigned long long id;
+  int idx;
+} skyindex_pair;
+
+// Growable list of sorted-position indices gathered during a search
+typedef struct {
+  int *list;
+  int  n;
+  int  size;
+} skyindex_hits;
+
+
+/* Static helpers, defined below */
+static unsigned long long skyindex_locate(const double p[3], int depth);
+static void skyindex_children(const double v[3][3], double c[4][3][3]);
+static void skyindex_visit(const skyindex *index, const double v[3][3],
+			   unsigned long long id, int level, const double p[3],
+			   double radius, double cos_r, skyindex_hits *hits);
+static void skyindex_cap(const skyindex *index, const double p[3],
+			 double radius, skyindex_hits *hits);
+static int  skyindex_compare(const void *a, const void *b);
+
+
+/* Function for building the index over n positions given as RA & Dec
+   (degree) columns.  depth is the HTM level of the leaf trixels; at level
+   d the trixels are roughly 90 / 2^d degrees on a side.  O(n log n).    */
+skyindex *skyindex_build(const double *ra, const double *dec, int n,
+			 int depth){
+
+  /* Variable Declarations */
+  int i;
+  double p[3];
+  skyindex *index;
+  skyindex_pair *pairs;
+
+  /* Keep the depth within what a 64-bit trixel ID can hold */
+  if(depth < 1)
+    depth = 1;
+  if(depth > SKYINDEX_MAX_DEPTH)
+    depth = SKYINDEX_MAX_DEPTH;
+
+  index = (skyindex *)malloc(sizeof(skyindex));
+  index->n     = n;
+  index->depth = depth;
+  index->htmid = (unsigned long long *)malloc(n * sizeof(unsigned long long));
+  index->idx   = (int *)malloc(n * sizeof(int));
+  index->x     = (double *)malloc(3 * (size_t)n * sizeof(double));
+  index->y     = index->x + n;
+  index->z     = index->y + n;
+
+  /* Leaf trixel ID for every position, then sort on the ID */
+  pairs = (skyindex_pair *)malloc(n * sizeof(skyindex_pair));
+  for(i=0; i<n; i++){
+    astrom_unit_vector(ra[i], dec[i], &p[0], &p[1], &p[2]);
+    pairs[i].id  = skyindex_locate(p, depth);
+    pairs[i].idx = i;
+  }
+  qsort(pairs, n, sizeof(skyindex_pair), skyindex_compare);
+
+  /* Store positions in sorted order, remembering where they came from */
+  for(i=0; i<n; i++){
+    index->htmid[i] = pairs[i].id;
+    index->idx[i]   = pairs[i].idx;
+    astrom_unit_vector(ra[pairs[i].idx], dec[pairs[i].idx],
+		       &index->x[i], &index->y[i], &index->z[i]);
+  }
+
+  free(pairs);
+
+  return index;
+}
+
+
+/* Function for building the index over a catalog_lib array */
+skyindex *skyindex_build_lib(const catalog_lib *objects, int n, int depth){
+
+  /* Variable Declarations */
+  int i;
+  double *radec;
+  skyindex *index;
+
+  /* Gather the coordinates into columns, then build */
+  radec = (double *)malloc(2 * n * sizeof(double));
+  for(i=0; i<n; i++){
+    radec[i]   = objects[i].ra;
+    radec[n+i] = objects[i].dec;
+  }
+
+  index = skyindex_build(radec, radec + n, n, depth);
+
+  free(radec);
+
+  return index;
+}
+
+
+/* Function for building a sky index straight from the RA & Dec columns
+   of a columnar catalog */
+skyindex *skyindex_build_soa(const catalog_soa *cat, int depth){
+
+  return skyindex_build(cat->ra, cat->dec, cat->n, depth);
+}
+
+
+/* Function to free the memory associated with a sky index */
+void skyindex_free(skyindex *index){
+
+  if(index == NULL)
+    return;
+
+  free(index->htmid);
+  free(index->idx);
+  free(index->x);
+  free(index);
+
+  return;
+}
+
+
+/* Function for finding all indexed positions within radius (degrees) of
+   center.  Returns a malloc'd array of catalog indices, *n of them.     */
+int *skyindex_cone(const skyindex *index, const astrom_coords *center,
+		   double radius, int *n){
+
+  /* Variable Declarations */
+  int i;
+  double p[3];
+  skyindex_hits hits = {NULL, 0, 0};
+
+  astrom_unit_vector(center->ra, center->dec, &p[0], &p[1], &p[2]);
+  skyindex_cap(index, p, radius, &hits);
+
+  /* Convert sorted positions back to catalog indices */
+  for(i=0; i<hits.n; i++)
+    hits.list[i] = index->idx[hits.list[i]];
+
+  *n = hits.n;
+
+  return hits.list;
+}
+
+
+/* Function for finding all indexed positions inside an RA/Dec box (all in
+   degrees).  If ra_min > ra_max, the box wraps through RA = 0.
+   The search runs over a cap enclosing the box, then each candidate is
+   checked against the box itself.  Returns a malloc'd array of catalog
+   indices, *n of them.                                                   */
+int *skyindex_box(const skyindex *index, double ra_min, double ra_max,
+		  double dec_min, double dec_max, int *n){
+
+  /* Variable Declarations */
+  int i,j,k,nfound;
+  double span,ra,dec,radius,r,p[3];
+  astrom_coords center,corner;
+  skyindex_hits hits = {NULL, 0, 0};
+
+  /* RA extent of the box, allowing for the wrap through 0 */
+  span = ra_max - ra_min;
+  if(span < 0.)
+    span += 360.;
+
+  /* Enclosing cap: about the box center while the box spans less than
+     12h of RA (the farthest points are then the corners), otherwise about
+     the nearer pole, or failing that the whole sky.                     */
+  if(span < 180.){
+    center.ra  = fmod(ra_min + span / 2., 360.);
+    center.dec = (dec_min + dec_max) / 2.;
+    radius = 0.;
+    for(j=0; j<2; j++)
+      for(k=0; k<2; k++){
+	corner.ra  = (j == 0) ? ra_min  : ra_max;
+	corner.dec = (k == 0) ? dec_min : dec_max;
+	r = astrom_ang_sep(&center, &corner);
+	if(r > radius) radius = r;
+      }
+  }
+  else if(dec_min > 0.){
+    center.ra  = 0.;
+    center.dec = 90.;
+    radius = 90. - dec_min;
+  }
+  else if(dec_max < 0.){
+    center.ra  = 0.;
+    center.dec = -90.;
+    radius = 90. + dec_max;
+  }
+  else{
+    center.ra  = 0.;
+    center.dec = 90.;
+    radius = 180.;
+  }
+
+  astrom_unit_vector(center.ra, center.dec, &p[0], &p[1], &p[2]);
+  skyindex_cap(index, p, radius + 1.e-9, &hits);
+
+  /* Keep the candidates actually inside the box */
+  nfound = 0;
+  for(i=0; i<hits.n; i++){
+    j   = hits.list[i];
+    dec = asin(index->z[j]) * RAD2DEG;
+    ra  = atan2(index->y[j], index->x[j]) * RAD2DEG;
+    if(ra < 0.)
+      ra += 360.;
+
+    if(dec < dec_min || dec > dec_max)
+      continue;
+
+    if(ra_min <= ra_max){
+      if(ra < ra_min || ra > ra_max)
+	continue;
+    }
+    else if(ra < ra_min && ra > ra_max)
+      continue;
+
+    hits.list[nfound++] = index->idx[j];
+  }
+
+  *n = nfound;
+
+  return hits.list;
+}
+
+
+/* Function to gather the sorted positions inside a cap of radius (degrees)
+   about unit vector p, walking down from the eight root trixels */
+static void skyindex_cap(const skyindex *index, const double p[3],
+			 double radius, skyindex_hits *hits){
+
+  /* Variable Declarations */
+  int i,j;
+  double v[3][3];
+
+  for(i=0; i<8; i++){
+    for(j=0; j<3; j++){
+      v[j][0] = skyindex_vert[skyindex_root[i][j]][0];
+      v[j][1] = skyindex_vert[skyindex_root[i][j]][1];
+      v[j][2] = skyindex_vert[skyindex_root[i][j]][2];
+    }
+    skyindex_visit(index, v, 8 + i, 0, p, radius * DEG2RAD,
+		   cos(radius * DEG2RAD), hits);
+  }
+
+  return;
+}
+
+
+/* Function to classify one trixel against the search cap, recursing into
+   its children when the trixel is only partially covered */
+static void skyindex_visit(const skyindex *index, const double v[3][3],
+			   unsigned long long id, int level, const double p[3],
+			   double radius, double cos_r, skyindex_hits *hits){
+
+  /* Variable Declarations */
+  int i,j,lo,hi,mid,shift,inside;
+  unsigned long long first,last;
+  double c[3],norm,r_t,d,child[4][3][3];
+
+  /* Slice of the sorted arrays falling within this trixel */
+  shift = 2 * (index->depth - level);
+  first = id << shift;
+  last  = (id + 1) << shift;
+
+  lo = 0;
+  hi = index->n;
+  while(lo < hi){
+    mid = lo + (hi - lo) / 2;
+    if(index->htmid[mid] < first) lo = mid + 1;
+    else hi = mid;
+  }
+  i  = lo;
+  hi = index->n;
+  while(lo < hi){
+    mid = lo + (hi - lo) / 2;
+    if(index->htmid[mid] < last) lo = mid + 1;
+    else hi = mid;
+  }
+  j = lo;
+
+  if(i == j)                // Nothing indexed here
+    return;
+
+  /* Bounding circle of the trixel:  center on the vertex mean, radius out
+     to the farthest vertex.  Reject if it cannot reach the cap.         */
+  c[0] = v[0][0] + v[1][0] + v[2][0];
+  c[1] = v[0][1] + v[1][1] + v[2][1];
+  c[2] = v[0][2] + v[1][2] + v[2][2];
+  norm = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
+  c[0] /= norm;
+  c[1] /= norm;
+  c[2] /= norm;
+
+  r_t = 0.;
+  inside = 0;
+  for(mid=0; mid<3; mid++){
+    d = acos(fmin(1., c[0]*v[mid][0] + c[1]*v[mid][1] + c[2]*v[mid][2]));
+    if(d > r_t) r_t = d;
+    if(p[0]*v[mid][0] + p[1]*v[mid][1] + p[2]*v[mid][2] >= cos_r)
+      inside++;
+  }
+
+  d = acos(fmax(-1., fmin(1., c[0]*p[0] + c[1]*p[1] + c[2]*p[2])));
+  if(d > radius + r_t + SKYINDEX_EPS)
+    return;
+
+  /* All vertices in a cap smaller than a hemisphere -- the whole trixel
+     is inside, so take the whole slice without testing positions */
+  if(inside == 3 && radius < M_PI / 2.){
+    for(; i<j; i++){
+      if(hits->n == hits->size){
+	hits->size = (hits->size) ? 2 * hits->size : 256;
+	hits->list = (int *)realloc(hits->list, hits->size * sizeof(int));
+      }
+      hits->list[hits->n++] = i;
+    }
+    return;
+  }
+
+  /* Leaf trixel crossed by the cap edge -- test each position */
+  if(level == index->depth){
+    for(; i<j; i++)
+      if(index->x[i]*p[0] + index->y[i]*p[1] + index->z[i]*p[2] >= cos_r){
+	if(hits->n == hits->size){
+	  hits->size = (hits->size) ? 2 * hits->size : 256;
+	  hits->list = (int *)realloc(hits->list, hits->size * sizeof(int));
+	}
+	hits->list[hits->n++] = i;
+      }
+    return;
+  }
+
+  /* Otherwise, on to the four children */
+  skyindex_children(v, child);
+  for(mid=0; mid<4; mid++)
+    skyindex_visit(index, child[mid], (id << 2) + mid, level + 1, p,
+		   radius, cos_r, hits);
+
+  return;
+}
+
+
+/* Function to split trixel v into its four children, in HTM order:
+   w0,w1,w2 are the midpoints of the edges opposite v0,v1,v2, and
+     child 0 = (v0,w2,w1)   child 1 = (v1,w0,w2)
+     child 2 = (v2,w1,w0)   child 3 = (w0,w1,w2)                        */
+static void skyindex_children(const double v[3][3], double c[4][3][3]){
+
+  /* Variable Declarations */
+  int i,k;
+  double w[3][3],norm;
+
+  for(i=0; i<3; i++){
+    for(k=0; k<3; k++)
+      w[i][k] = v[(i+1)%3][k] + v[(i+2)%3][k];
+    norm = sqrt(w[i][0]*w[i][0] + w[i][1]*w[i][1] + w[i][2]*w[i][2]);
+    for(k=0; k<3; k++)
+      w[i][k] /= norm;
+  }
+
+  for(k=0; k<3; k++){
+    c[0][0][k] = v[0][k];  c[0][1][k] = w[2][k];  c[0][2][k] = w[1][k];
+    c[1][0][k] = v[1][k];  c[1][1][k] = w[0][k];  c[1][2][k] = w[2][k];
+    c[2][0][k] = v[2][k];  c[2][1][k] = w[1][k];  c[2][2][k] = w[0][k];
+    c[3][0][k] = w[0][k];  c[3][1][k] = w[1][k];  c[3][2][k] = w[2][k];
+  }
+
+  return;
+}
+
+
+/* Function to find the ID of the leaf trixel (at depth) holding unit
+   vector p.  At each level the trixel chosen is the one for which p is
+   farthest inside all three edges, so points on edges always land
+   somewhere despite round-off.                                          */
+static unsigned long long skyindex_locate(const double p[3], int depth){
+
+  /* Variable Declarations */
+  int i,j,k,level,best;
+  unsigned long long id;
+  double v[3][3],tri[4][3][3],edge,worst,best_worst;
+  const double *a,*b;
+
+  /* Candidate trixels:  the 8 roots, then 4 children at each level */
+  best = 0;
+  best_worst = -2.;
+  for(i=0; i<8; i++){
+    worst = 2.;
+    for(j=0; j<3; j++){
+      a = skyindex_vert[skyindex_root[i][j]];
+      b = skyindex_vert[skyindex_root[i][(j+1)%3]];
+      edge = (a[1]*b[2] - a[2]*b[1]) * p[0] + (a[2]*b[0] - a[0]*b[2]) * p[1]
+	+ (a[0]*b[1] - a[1]*b[0]) * p[2];
+      if(edge < worst) worst = edge;
+    }
+    if(worst > best_worst){
+      best_worst = worst;
+      best = i;
+    }
+  }
+
+  id = 8 + best;
+  for(j=0; j<3; j++)
+    for(k=0; k<3; k++)
+      v[j][k] = skyindex_vert[skyindex_root[best][j]][k];
+
+  for(level=0; level<depth; level++){
+    skyindex_children(v, tri);
+    best = 0;
+    best_worst = -2.;
+    for(i=0; i<4; i++){
+      worst = 2.;
+      for(j=0; j<3; j++){
+	a = tri[i][j];
+	b = tri[i][(j+1)%3];
+	edge = (a[1]*b[2] - a[2]*b[1]) * p[0] +
+	  (a[2]*b[0] - a[0]*b[2]) * p[1] + (a[0]*b[1] - a[1]*b[0]) * p[2];
+	if(edge < worst) worst = edge;
+      }
+      if(worst > best_worst){
+	best_worst = worst;
+	best = i;
+      }
+    }
+
+    id = (id << 2) + best;
+    for(j=0; j<3; j++)
+      for(k=0; k<3; k++)
+	v[j][k] = tri[best][j][k];
+  }
+
+  return id;
+}
+
+
+/* Comparison function for qsort() -- by trixel ID, then catalog index */
+static int skyindex_compare(const void *a, const void *b){
+
+  const skyindex_pair *pa = (const skyindex_pair *)a;
+  const skyindex_pair *pb = (const skyindex_pair *)b;
+
+  if(pa->id < pb->id) return -1;
+  if(pa->id > pb->id) return  1;
+  return pa->idx - pb->idx;
+}
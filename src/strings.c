@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include <tpeb.h>
 
@@ -75,3 +76,73 @@ int strings_getline(FILE *f, char *buf, size_t *length){
   return 1;
   
 }
+
+
+/* Function to write val right-justified in exactly width characters with
+   ndigits decimals, as printf("%*.*f") would, but with integer arithmetic
+   on a single rounding (values within an ulp of a tie may round the other
+   way).  Decimals are dropped if the number would not
+   fit; if even the integer part does not fit (or val is not finite) the
+   field is filled with '*'.  Returns the position after the field (not
+   terminated).                                                          */
+char *strings_put_fixed(char *p, double val, int width, int ndigits){
+  
+  /* Variable Declarations */
+  int i,nd,nint,len,sign;
+  long long unit,ticks,ip,v;
+  static const long long pow10[10] = {1LL,10LL,100LL,1000LL,10000LL,
+				      100000LL,1000000LL,10000000LL,
+				      100000000LL,1000000000LL};
+  
+  if(ndigits > 9) ndigits = 9;
+  if(ndigits < 0) ndigits = 0;
+  
+  for(nd=ndigits; nd>=0 && isfinite(val) && fabs(val) < 1.e9; nd--){
+    unit  = pow10[nd];
+    ticks = llrint(fabs(val) * (double)unit);      // Ties to even, as printf
+    ip    = ticks / unit;
+    sign  = (val < 0. && ticks != 0);   // No "-0.00"
+    
+    // Characters needed: sign, integer digits, point & decimals
+    for(nint=1, v=ip; v >= 10; v /= 10)
+      nint++;
+    len = sign + nint + ((nd) ? nd + 1 : 0);
+    if(len > width)
+      continue;
+    
+    for(i=0; i<width-len; i++)
+      *p++ = ' ';
+    if(sign)
+      *p++ = '-';
+    for(i=nint-1, v=ip; i>=0; i--, v /= 10)
+      p[i] = '0' + (char)(v % 10);
+    p += nint;
+    if(nd){
+      *p++ = '.';
+      for(i=nd-1, v=ticks % unit; i>=0; i--, v /= 10)
+	p[i] = '0' + (char)(v % 10);
+      p += nd;
+    }
+    return p;
+  }
+  
+  for(i=0; i<width; i++)
+    *p++ = '*';
+  return p;
+}
+
+
+/* Function to write str left-justified in exactly width characters, cut
+   or padded with blanks.  Returns the position after the field.        */
+char *strings_put_padded(char *p, const char *str, int width){
+  
+  /* Variable Declarations */
+  int i;
+  
+  for(i=0; i<width && str[i] != '\0'; i++)
+    p[i] = str[i];
+  for(; i<width; i++)
+    p[i] = ' ';
+  
+  return p + width;
+}
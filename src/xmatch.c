@@ -0,0 +1,412 @@
+/******** xmatch.c ********/
+/* Timothy Ellsworth Bowers
+
+   Cross-matching of two catalogs by position, using the zone algorithm
+   (Gray, Nieto-Santisteban & Szalay 2006):  the second catalog is cut
+   into declination zones, each sorted by RA, so that the candidates for a
+   position in the first catalog are found by binary search in the few
+   zones within the match radius, over an RA window widened for the
+   declination.  The first catalog is split into contiguous chunks, one
+   per thread.
+
+   Calling sequence:
+     pairs = xmatch_lib(cat1, n1, cat2, n2, radius, XMATCH_BEST, 0, &npairs);
+     .
+     .
+     free(pairs);
+
+   The pairs come out grouped by i1 in ascending order.  XMATCH_BEST
+   gives (at most) one pair per entry of catalog 1, the nearest entry of
+   catalog 2; XMATCH_ALL gives every pair within the radius.  The radius
+   and the separations are in degrees.  Entries of either catalog whose
+   RA or Dec is not finite (the catalog readers give NAN for positions
+   that do not scan) never match.  The returned array must be freed by
+   the calling function.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include <tpeb.h>
+
+#define XMATCH_ZONE_MIN (1./60.)  // Smallest zone height (degrees)
+
+// Catalog 2, sorted by zone then RA
+typedef struct {
+  int     n;
+  int     nzones;
+  double  height;       // Zone height (degrees)
+  int    *zstart;       // Start of each zone in the sorted arrays
+  double *ra;           // RA (degrees) -- the key within a zone
+  double *x;            // Unit vectors
+  double *y;
+  double *z;
+  int    *idx;          // Catalog 2 index of each sorted entry
+} xmatch_zones;
+
+// Sort key used while building the zones
+typedef struct {
+  int    zone;
+  double ra;
+  int    idx;
+} xmatch_key;
+
+// Per-thread work block
+typedef struct {
+  const xmatch_zones *zones;
+  const double *ra;     // Catalog 1
+  const double *dec;
+  int    first;         // Range of catalog 1 handled by this thread
+  int    last;
+  double radius;
+  int    mode;
+  xmatch_pair *pairs;   // Output, grown as needed
+  int    npairs;
+  int    size;
+} xmatch_work;
+
+
+/* Static helpers, defined below */
+static void  xmatch_zones_build(xmatch_zones *zones, const double *ra,
+				const double *dec, int n, double radius);
+static void *xmatch_worker(void *arg);
+static void  xmatch_scan(xmatch_work *work, int zone, double ra_lo,
+			 double ra_hi, const double p[3], double cos_r,
+			 int i1, xmatch_pair *best);
+static int   xmatch_compare(const void *a, const void *b);
+
+
+/* Function for cross-matching catalog 1 (ra1, dec1) against catalog 2
+   (ra2, dec2), all RA & Dec columns in degrees, within radius degrees.
+   mode is XMATCH_BEST or XMATCH_ALL; nthreads <= 0 uses all cores.
+   Returns a malloc'd array of *npairs matched pairs.                   */
+xmatch_pair *xmatch_radec(const double *ra1, const double *dec1, int n1,
+			  const double *ra2, const double *dec2, int n2,
+			  double radius, int mode, int nthreads,
+			  int *npairs){
+
+  /* Variable Declarations */
+  int i,k,chunk;
+  xmatch_zones zones;
+  xmatch_work *work;
+  xmatch_pair *pairs;
+
+  xmatch_zones_build(&zones, ra2, dec2, n2, radius);
+
+  /* Split catalog 1 into one contiguous range per thread */
+  nthreads = parallel_nthreads(nthreads);
+  if(nthreads > n1)
+    nthreads = (n1 > 0) ? n1 : 1;
+  chunk = (n1 + nthreads - 1) / nthreads;
+
+  work = (xmatch_work *)malloc(nthreads * sizeof(xmatch_work));
+  for(k=0; k<nthreads; k++){
+    work[k].zones  = &zones;
+    work[k].ra     = ra1;
+    work[k].dec    = dec1;
+    work[k].first  = k * chunk;
+    work[k].last   = ((k + 1) * chunk < n1) ? (k + 1) * chunk : n1;
+    work[k].radius = radius;
+    work[k].mode   = mode;
+    work[k].pairs  = NULL;
+    work[k].npairs = 0;
+    work[k].size   = 0;
+  }
+
+  parallel_run(nthreads, xmatch_worker, work, sizeof(xmatch_work));
+
+  /* Concatenate the per-thread results, in catalog 1 order */
+  *npairs = 0;
+  for(k=0; k<nthreads; k++)
+    *npairs += work[k].npairs;
+
+  pairs = (xmatch_pair *)malloc((*npairs + 1) * sizeof(xmatch_pair));
+  i = 0;
+  for(k=0; k<nthreads; k++){
+    if(work[k].npairs)
+      memcpy(pairs + i, work[k].pairs, work[k].npairs * sizeof(xmatch_pair));
+    i += work[k].npairs;
+    free(work[k].pairs);
+  }
+
+  free(work);
+  free(zones.zstart);
+  free(zones.ra);
+  free(zones.x);
+  free(zones.idx);
+
+  return pairs;
+}
+
+
+/* Function for cross-matching two catalog_lib arrays */
+xmatch_pair *xmatch_lib(const catalog_lib *cat1, int n1,
+			const catalog_lib *cat2, int n2, double radius,
+			int mode, int nthreads, int *npairs){
+
+  /* Variable Declarations */
+  int i;
+  double *c1,*c2;
+  xmatch_pair *pairs;
+
+  /* Gather the coordinates into columns, then match */
+  c1 = (double *)malloc(2 * n1 * sizeof(double));
+  c2 = (double *)malloc(2 * n2 * sizeof(double));
+  for(i=0; i<n1; i++){
+    c1[i]    = cat1[i].ra;
+    c1[n1+i] = cat1[i].dec;
+  }
+  for(i=0; i<n2; i++){
+    c2[i]    = cat2[i].ra;
+    c2[n2+i] = cat2[i].dec;
+  }
+
+  pairs = xmatch_radec(c1, c1 + n1, n1, c2, c2 + n2, n2, radius, mode,
+		       nthreads, npairs);
+
+  free(c1);
+  free(c2);
+
+  return pairs;
+}
+
+
+/* Function for cross-matching two catalog_mmt arrays */
+xmatch_pair *xmatch_mmt(const catalog_mmt *cat1, int n1,
+			const catalog_mmt *cat2, int n2, double radius,
+			int mode, int nthreads, int *npairs){
+
+  /* Variable Declarations */
+  int i;
+  double *c1,*c2;
+  xmatch_pair *pairs;
+
+  /* Gather the coordinates into columns, then match */
+  c1 = (double *)malloc(2 * n1 * sizeof(double));
+  c2 = (double *)malloc(2 * n2 * sizeof(double));
+  for(i=0; i<n1; i++){
+    c1[i]    = cat1[i].ra;
+    c1[n1+i] = cat1[i].dec;
+  }
+  for(i=0; i<n2; i++){
+    c2[i]    = cat2[i].ra;
+    c2[n2+i] = cat2[i].dec;
+  }
+
+  pairs = xmatch_radec(c1, c1 + n1, n1, c2, c2 + n2, n2, radius, mode,
+		       nthreads, npairs);
+
+  free(c1);
+  free(c2);
+
+  return pairs;
+}
+
+
+/* Function to cross-match two columnar catalogs on their RA & Dec columns
+   directly, with no gather */
+xmatch_pair *xmatch_soa(const catalog_soa *cat1, const catalog_soa *cat2,
+			double radius, int mode, int nthreads, int *npairs){
+
+  return xmatch_radec(cat1->ra, cat1->dec, cat1->n, cat2->ra, cat2->dec,
+		      cat2->n, radius, mode, nthreads, npairs);
+}
+
+
+/* Function to cut catalog 2 into declination zones sorted by RA;
+   entries without a finite position are left out */
+static void xmatch_zones_build(xmatch_zones *zones, const double *ra,
+			       const double *dec, int n, double radius){
+
+  /* Variable Declarations */
+  int i,z;
+  xmatch_key *keys;
+
+  zones->height = (radius > XMATCH_ZONE_MIN) ? radius : XMATCH_ZONE_MIN;
+  zones->nzones = (int)ceil(180. / zones->height) + 1;
+
+  /* Sort on zone, then RA */
+  keys = (xmatch_key *)malloc((n + 1) * sizeof(xmatch_key));
+  zones->n = 0;
+  for(i=0; i<n; i++){
+    if(!isfinite(ra[i]) || !isfinite(dec[i]))
+      continue;
+    z = (int)floor((dec[i] + 90.) / zones->height);
+    if(z < 0) z = 0;
+    if(z >= zones->nzones) z = zones->nzones - 1;
+    keys[zones->n].zone = z;
+    keys[zones->n].ra   = ra[i];
+    keys[zones->n].idx  = i;
+    zones->n++;
+  }
+  n = zones->n;
+  qsort(keys, n, sizeof(xmatch_key), xmatch_compare);
+
+  zones->zstart = (int *)calloc(zones->nzones + 1, sizeof(int));
+  zones->ra     = (double *)malloc((n + 1) * sizeof(double));
+  zones->x      = (double *)malloc(3 * ((size_t)n + 1) * sizeof(double));
+  zones->y      = zones->x + n;
+  zones->z      = zones->y + n;
+  zones->idx    = (int *)malloc((n + 1) * sizeof(int));
+
+  for(i=0; i<n; i++){
+    zones->ra[i]  = keys[i].ra;
+    zones->idx[i] = keys[i].idx;
+    astrom_unit_vector(keys[i].ra, dec[keys[i].idx],
+		       &zones->x[i], &zones->y[i], &zones->z[i]);
+    zones->zstart[keys[i].zone + 1]++;
+  }
+
+  /* Counts to starting offsets */
+  for(z=0; z<zones->nzones; z++)
+    zones->zstart[z+1] += zones->zstart[z];
+
+  free(keys);
+
+  return;
+}
+
+
+/* Thread worker:  match entries first .. last-1 of catalog 1 */
+static void *xmatch_worker(void *arg){
+
+  /* Variable Declarations */
+  int i,z,z_lo,z_hi;
+  double p[3],cos_r,r,dec,alpha,lo,hi,c_lo,c_hi;
+  xmatch_pair best;
+  xmatch_work *work = (xmatch_work *)arg;
+  const xmatch_zones *zones = work->zones;
+
+  r     = work->radius;
+  cos_r = cos(r * DEG2RAD);
+
+  for(i=work->first; i<work->last; i++){
+    dec = work->dec[i];
+    if(!isfinite(work->ra[i]) || !isfinite(dec))
+      continue;
+    astrom_unit_vector(work->ra[i], dec, &p[0], &p[1], &p[2]);
+
+    /* Zones that can hold a match */
+    z_lo = (int)floor((dec - r + 90.) / zones->height);
+    z_hi = (int)floor((dec + r + 90.) / zones->height);
+    if(z_lo < 0) z_lo = 0;
+    if(z_hi >= zones->nzones) z_hi = zones->nzones - 1;
+
+    /* Half-width of the RA window at this declination:
+          alpha = atan( sin r / sqrt|cos(dec - r) cos(dec + r)| )
+       or the full circle once the radius reaches a pole            */
+    if(fabs(dec) + r >= 89.999)
+      alpha = 180.;
+    else{
+      c_lo  = cos((dec - r) * DEG2RAD);
+      c_hi  = cos((dec + r) * DEG2RAD);
+      alpha = atan(sin(r * DEG2RAD) / sqrt(fabs(c_lo * c_hi))) * RAD2DEG;
+      alpha += 1.e-9;
+    }
+
+    best.i1  = i;
+    best.i2  = -1;
+    best.sep = 360.;
+
+    for(z=z_lo; z<=z_hi; z++){
+      lo = work->ra[i] - alpha;
+      hi = work->ra[i] + alpha;
+
+      // Window wrapping through RA = 0 is scanned in two pieces
+      if(alpha >= 180.)
+	xmatch_scan(work, z, -1., 361., p, cos_r, i, &best);
+      else if(lo < 0.){
+	xmatch_scan(work, z, 0., hi, p, cos_r, i, &best);
+	xmatch_scan(work, z, lo + 360., 361., p, cos_r, i, &best);
+      }
+      else if(hi > 360.){
+	xmatch_scan(work, z, lo, 361., p, cos_r, i, &best);
+	xmatch_scan(work, z, -1., hi - 360., p, cos_r, i, &best);
+      }
+      else
+	xmatch_scan(work, z, lo, hi, p, cos_r, i, &best);
+    }
+
+    if(work->mode == XMATCH_BEST && best.i2 >= 0){
+      if(work->npairs == work->size){
+	work->size  = (work->size) ? 2 * work->size : 1024;
+	work->pairs = (xmatch_pair *)realloc(work->pairs,
+					     work->size * sizeof(xmatch_pair));
+      }
+      work->pairs[work->npairs++] = best;
+    }
+  }
+
+  return NULL;
+}
+
+
+/* Function to test the catalog 2 entries of one zone with RA in
+   [ra_lo, ra_hi] against unit vector p of catalog 1 entry i1 */
+static void xmatch_scan(xmatch_work *work, int zone, double ra_lo,
+			double ra_hi, const double p[3], double cos_r,
+			int i1, xmatch_pair *best){
+
+  /* Variable Declarations */
+  int j,lo,hi,mid;
+  double dot,dx,dy,dz,sep;
+  const xmatch_zones *zones = work->zones;
+
+  /* First entry of the zone at or above ra_lo */
+  lo = zones->zstart[zone];
+  hi = zones->zstart[zone+1];
+  while(lo < hi){
+    mid = lo + (hi - lo) / 2;
+    if(zones->ra[mid] < ra_lo) lo = mid + 1;
+    else hi = mid;
+  }
+
+  for(j=lo; j<zones->zstart[zone+1] && zones->ra[j] <= ra_hi; j++){
+    dot = zones->x[j]*p[0] + zones->y[j]*p[1] + zones->z[j]*p[2];
+    if(dot < cos_r)
+      continue;
+
+    // Chord-length separation, accurate at small angles
+    dx  = zones->x[j] - p[0];
+    dy  = zones->y[j] - p[1];
+    dz  = zones->z[j] - p[2];
+    sep = 2. * asin(fmin(1., sqrt(dx*dx + dy*dy + dz*dz) / 2.)) * RAD2DEG;
+
+    if(work->mode == XMATCH_BEST){
+      if(sep < best->sep || (sep == best->sep && zones->idx[j] < best->i2)){
+	best->i2  = zones->idx[j];
+	best->sep = sep;
+      }
+    }
+    else{
+      if(work->npairs == work->size){
+	work->size  = (work->size) ? 2 * work->size : 1024;
+	work->pairs = (xmatch_pair *)realloc(work->pairs,
+					     work->size * sizeof(xmatch_pair));
+      }
+      work->pairs[work->npairs].i1  = i1;
+      work->pairs[work->npairs].i2  = zones->idx[j];
+      work->pairs[work->npairs].sep = sep;
+      work->npairs++;
+    }
+  }
+
+  return;
+}
+
+
+/* Comparison function for qsort() -- by zone, then RA */
+static int xmatch_compare(const void *a, const void *b){
+
+  const xmatch_key *ka = (const xmatch_key *)a;
+  const xmatch_key *kb = (const xmatch_key *)b;
+
+  if(ka->zone != kb->zone)
+    return ka->zone - kb->zone;
+  if(ka->ra < kb->ra) return -1;
+  if(ka->ra > kb->ra) return  1;
+  return ka->idx - kb->idx;
+}
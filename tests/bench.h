@@ -0,0 +1,31 @@
+/******** bench.h ********/
+/* Timing helpers shared by the bench_*.c programs.  The benchmarks are
+   built by `make check' but not run; run them by hand, e.g.
+   ./tests/bench_atime_iso
+
+*/
+
+#include <stdio.h>
+#include <time.h>
+
+/* Monotonic wall-clock time in seconds */
+static double bench_seconds(void){
+  
+  struct timespec ts;
+  
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  
+  return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+}
+
+/* One line of results:  ns per call, & the speedup over a reference */
+static void bench_report(const char *name, long n, double secs, double ref){
+  
+  if(ref > 0.)
+    printf("  %-40s %9.1f ns/call  %6.2fx\n", name, 1.e9 * secs / n,
+	   ref / secs);
+  else
+    printf("  %-40s %9.1f ns/call\n", name, 1.e9 * secs / n);
+  
+  return;
+}
@@ -0,0 +1,98 @@
+/******** bench_astrom_sep.c ********/
+/* Benchmark of the batched angular separations, astrom_ang_sep_batch()
+   (one position against many) & astrom_ang_sep_matrix() (all pairs of
+   two sets), against loops over the scalar astrom_ang_sep().  The
+   largest difference from the scalar results is printed as well.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <tpeb.h>
+#include "bench.h"
+
+#define NPOS   100000   // Positions for the one-to-many case
+#define NREP   50
+#define NSET   1000     // Size of each set for the matrix case
+
+
+int main(void){
+  
+  /* Variable Declarations */
+  int i,j,k;
+  double *ra,*dec,*sep,*ref_sep,t0,ref,worst,sum=0.;
+  astrom_coords *obj,center;
+  
+  obj     = (astrom_coords *)malloc(NPOS * sizeof(astrom_coords));
+  ra      = (double *)malloc(NPOS * sizeof(double));
+  dec     = (double *)malloc(NPOS * sizeof(double));
+  sep     = (double *)malloc((size_t)NSET * NSET * sizeof(double));
+  ref_sep = (double *)malloc((size_t)NSET * NSET * sizeof(double));
+  
+  srand(1);
+  for(i=0; i<NPOS; i++){
+    obj[i].ra  = ra[i]  = 360. * rand() / ((double)RAND_MAX + 1.);
+    obj[i].dec = dec[i] = asin(2. * rand() / ((double)RAND_MAX + 1.) - 1.) *
+      RAD2DEG;
+  }
+  center.ra  = 150.1;
+  center.dec = 2.2;
+  
+  /* One position against NPOS */
+  printf("%d positions x %d\n", NPOS, NREP);
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++){
+    for(i=0; i<NPOS; i++)
+      ref_sep[i] = astrom_ang_sep(&center, &obj[i]);
+    sum += ref_sep[k];
+  }
+  ref = bench_seconds() - t0;
+  bench_report("astrom_ang_sep() loop", (long)NREP * NPOS, ref, 0.);
+  
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++){
+    astrom_ang_sep_batch(&center, ra, dec, NPOS, sep);
+    sum += sep[k];
+  }
+  bench_report("astrom_ang_sep_batch()", (long)NREP * NPOS,
+	       bench_seconds() - t0, ref);
+  
+  for(worst=0., i=0; i<NPOS; i++)
+    if(fabs(sep[i] - ref_sep[i]) > worst)
+      worst = fabs(sep[i] - ref_sep[i]);
+  printf("  largest difference %.3g deg\n", worst);
+  
+  /* All NSET x NSET pairs (the first & last NSET positions) */
+  printf("%d x %d matrix\n", NSET, NSET);
+  t0 = bench_seconds();
+  for(i=0; i<NSET; i++)
+    for(j=0; j<NSET; j++)
+      ref_sep[i * NSET + j] = astrom_ang_sep(&obj[i], &obj[NPOS - NSET + j]);
+  ref = bench_seconds() - t0;
+  sum += ref_sep[NSET];
+  bench_report("astrom_ang_sep() loop", (long)NSET * NSET, ref, 0.);
+  
+  t0 = bench_seconds();
+  astrom_ang_sep_matrix(ra, dec, NSET, ra + NPOS - NSET, dec + NPOS - NSET,
+			NSET, sep);
+  bench_report("astrom_ang_sep_matrix()", (long)NSET * NSET,
+	       bench_seconds() - t0, ref);
+  sum += sep[NSET];
+  
+  for(worst=0., i=0; i<NSET * NSET; i++)
+    if(fabs(sep[i] - ref_sep[i]) > worst)
+      worst = fabs(sep[i] - ref_sep[i]);
+  printf("  largest difference %.3g deg\n", worst);
+  
+  printf("(checksum %g)\n", sum);
+  
+  free(obj);
+  free(ra);
+  free(dec);
+  free(sep);
+  free(ref_sep);
+  
+  return 0;
+}
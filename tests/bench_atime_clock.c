@@ -0,0 +1,137 @@
+/******** bench_atime_clock.c ********/
+/* Microbenchmark of the clock routines:  atime_clock(), atime_now() &
+   atime_context_now() against the old path of atime_get_date_now()
+   (time() & gettimeofday(), localtime() / gmtime(), seven strftime()
+   & atoi() round trips and a malloc() per call), kept here verbatim as
+   old_get_date_now() for reference.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include <tpeb.h>
+#include "bench.h"
+
+#define NCALL 1000000
+
+static atime_time *old_get_date_now(int clock_type);
+
+
+int main(void){
+  
+  /* Variable Declarations */
+  int i,k;
+  double t0,ref,sum=0.;
+  atime_time *p,date;
+  atime_context ctx;
+  static const int types[2] = {ATIME_GMT, ATIME_LOCAL};
+  static const char *names[2] = {"GMT", "local"};
+  
+  printf("%d calls each\n", NCALL);
+  
+  for(k=0; k<2; k++){
+    printf(" %s time\n", names[k]);
+    
+    t0 = bench_seconds();
+    for(i=0; i<NCALL; i++){
+      p = old_get_date_now(types[k]);
+      sum += p->sec;
+      free(p);
+    }
+    ref = bench_seconds() - t0;
+    bench_report("old atime_get_date_now()", NCALL, ref, 0.);
+    
+    t0 = bench_seconds();
+    for(i=0; i<NCALL; i++){
+      p = atime_get_date_now(types[k]);
+      sum += p->sec;
+      free(p);
+    }
+    bench_report("atime_get_date_now()", NCALL, bench_seconds() - t0, ref);
+    
+    t0 = bench_seconds();
+    for(i=0; i<NCALL; i++){
+      atime_clock(types[k], &date);
+      sum += date.sec;
+    }
+    bench_report("atime_clock()", NCALL, bench_seconds() - t0, ref);
+    
+    t0 = bench_seconds();
+    for(i=0; i<NCALL; i++){
+      date = atime_now(types[k]);
+      sum += date.sec;
+    }
+    bench_report("atime_now()", NCALL, bench_seconds() - t0, ref);
+  }
+  
+  /* The context also carries the JD & sidereal time */
+  printf(" GMT context\n");
+  t0 = bench_seconds();
+  for(i=0; i<NCALL; i++){
+    p = old_get_date_now(ATIME_GMT);
+    sum += atime_lst(110.7, atime_jd(p->year, p->month, p->day +
+				     (p->hour + (p->min + p->sec / 60.) /
+				      60.) / 24.));
+    free(p);
+  }
+  ref = bench_seconds() - t0;
+  bench_report("old atime_get_date_now() + atime_lst()", NCALL, ref, 0.);
+  
+  t0 = bench_seconds();
+  for(i=0; i<NCALL; i++){
+    atime_context_now(&ctx);
+    sum += atime_lst_ctx(&ctx, 110.7);
+  }
+  bench_report("atime_context_now() + atime_lst_ctx()", NCALL,
+	       bench_seconds() - t0, ref);
+  
+  printf("(checksum %g)\n", sum);
+  
+  return 0;
+}
+
+
+/* The old atime_get_date_now(), before the clock routines */
+static atime_time *old_get_date_now(int clock_type){
+  
+  /* Variable Declarations */
+  atime_time *date;
+  char buf0[81],buf1[81],buf2[81],buf3[81],buf4[81],buf5[81],buf6[81];
+  time_t now;
+  struct tm *ptr = NULL;
+  struct timeval tv;
+  
+  
+  date = (atime_time *)malloc(sizeof(atime_time));
+  
+  /* Get time string */
+  time(&now);
+  if(clock_type == ATIME_LOCAL)
+    ptr = localtime(&now);  
+  else if(clock_type == ATIME_GMT)
+    ptr = gmtime(&now);  
+  gettimeofday(&tv, NULL); 
+  
+  /* Extract ascii information from the date */
+  /* And convert it to numbers */
+  
+  strftime(buf0, 80, "%S", ptr);
+  date->sec   = atof(buf0) + (float)tv.tv_usec/1000000.;
+  strftime(buf1, 80, "%M", ptr);
+  date->min   = atoi(buf1);
+  strftime(buf2, 80, "%H", ptr);
+  date->hour  = atoi(buf2);
+  strftime(buf3, 80, "%d", ptr);
+  date->day   = atoi(buf3);
+  strftime(buf5, 80, "%m", ptr);
+  date->month = atoi(buf5);
+  strftime(buf4, 80, "%Y", ptr);
+  date->year  = atoi(buf4);
+  strftime(buf6, 80, "%j", ptr);
+  date->doy   = atoi(buf6);
+  
+  return date;
+}
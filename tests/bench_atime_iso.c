@@ -0,0 +1,88 @@
+/******** bench_atime_iso.c ********/
+/* Benchmark of atime_iso_to_jd() & atime_jd_to_iso() against the
+   sscanf() / sprintf() path they replace (fields through sscanf() &
+   atime_jd(); atime_jd_to_date() & sprintf()).
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tpeb.h>
+#include "bench.h"
+
+#define NDATES 1000000
+#define NREP   5
+
+
+int main(void){
+  
+  /* Variable Declarations */
+  int i,k,year,month,day,hour,min;
+  double *jd,*back,sec,t0,ref,sum=0.;
+  char *text,buf[40];
+  atime_time date;
+  
+  jd   = (double *)malloc(NDATES * sizeof(double));
+  back = (double *)malloc(NDATES * sizeof(double));
+  text = (char *)malloc(NDATES * 32);
+  
+  srand(15);
+  for(i=0; i<NDATES; i++){
+    jd[i] = 2400000.5 + 73000. * rand() / ((double)RAND_MAX + 1.);
+    atime_jd_to_iso(jd[i], 3, text + 32 * i, 32);
+  }
+  printf("%d ISO dates x %d\n", NDATES, NREP);
+  
+  /* Parsing */
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++)
+    for(i=0; i<NDATES; i++){
+      sscanf(text + 32 * i, "%d-%d-%dT%d:%d:%lf", &year, &month, &day,
+	     &hour, &min, &sec);
+      back[i] = atime_jd(year, month, day) +
+	(hour * 3600. + min * 60. + sec) / 86400.;
+    }
+  ref = bench_seconds() - t0;
+  sum += back[NDATES-1];
+  bench_report("sscanf() + atime_jd()", (long)NREP * NDATES, ref, 0.);
+  
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++)
+    for(i=0; i<NDATES; i++)
+      atime_iso_to_jd(text + 32 * i, 23, &back[i], NULL);
+  bench_report("atime_iso_to_jd()", (long)NREP * NDATES,
+	       bench_seconds() - t0, ref);
+  sum += back[NDATES-1];
+  
+  /* Formatting */
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++)
+    for(i=0; i<NDATES; i++){
+      atime_jd_to_date(jd[i], &date);
+      sprintf(buf, "%04d-%02d-%02dT%02d:%02d:%06.3f", date.year, date.month,
+	      date.day, date.hour, date.min, date.sec);
+      sum += buf[22];
+    }
+  ref = bench_seconds() - t0;
+  bench_report("atime_jd_to_date() + sprintf()", (long)NREP * NDATES, ref,
+	       0.);
+  
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++)
+    for(i=0; i<NDATES; i++){
+      atime_jd_to_iso(jd[i], 3, buf, sizeof(buf));
+      sum += buf[22];
+    }
+  bench_report("atime_jd_to_iso()", (long)NREP * NDATES,
+	       bench_seconds() - t0, ref);
+  
+  printf("(checksum %g)\n", sum);
+  
+  free(jd);
+  free(back);
+  free(text);
+  
+  return 0;
+}
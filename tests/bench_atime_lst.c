@@ -0,0 +1,93 @@
+/******** bench_atime_lst.c ********/
+/* Throughput of the array time routines against their scalar forms:
+   atime_jd_array() vs atime_jd(), and atime_lst_array() & the LST
+   stepper vs atime_lst(), over blocks of NBLOCK values.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <tpeb.h>
+#include "bench.h"
+
+#define NBLOCK 4096
+#define NREP   2000
+
+
+int main(void){
+  
+  /* Variable Declarations */
+  int i,k,*year,*month;
+  long ncall = (long)NBLOCK * NREP;
+  double *day,*jd,*lst,t0,ref,sum=0.;
+  atime_lst_stepper st;
+  
+  year  = (int *)malloc(NBLOCK * sizeof(int));
+  month = (int *)malloc(NBLOCK * sizeof(int));
+  day   = (double *)malloc(NBLOCK * sizeof(double));
+  jd    = (double *)malloc(NBLOCK * sizeof(double));
+  lst   = (double *)malloc(NBLOCK * sizeof(double));
+  
+  srand(13);
+  for(i=0; i<NBLOCK; i++){
+    year[i]  = 1990 + rand() % 40;
+    month[i] = 1 + rand() % 12;
+    day[i]   = 1 + rand() % 28 + rand() / ((double)RAND_MAX + 1.);
+  }
+  printf("%d values x %d\n", NBLOCK, NREP);
+  
+  /* Calendar date to JD */
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++){
+    for(i=0; i<NBLOCK; i++)
+      jd[i] = atime_jd(year[i], month[i], day[i]);
+    sum += jd[k % NBLOCK];
+  }
+  ref = bench_seconds() - t0;
+  bench_report("atime_jd()", ncall, ref, 0.);
+  
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++){
+    atime_jd_array(year, month, day, NBLOCK, jd);
+    sum += jd[k % NBLOCK];
+  }
+  bench_report("atime_jd_array()", ncall, bench_seconds() - t0, ref);
+  
+  /* LST at those JDs */
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++){
+    for(i=0; i<NBLOCK; i++)
+      lst[i] = atime_lst(110.7, jd[i]);
+    sum += lst[k % NBLOCK];
+  }
+  ref = bench_seconds() - t0;
+  bench_report("atime_lst()", ncall, ref, 0.);
+  
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++){
+    atime_lst_array(110.7, jd, NBLOCK, lst);
+    sum += lst[k % NBLOCK];
+  }
+  bench_report("atime_lst_array()", ncall, bench_seconds() - t0, ref);
+  
+  /* LST over a uniform grid */
+  t0 = bench_seconds();
+  for(k=0; k<NREP; k++){
+    atime_lst_stepper_init(&st, 110.7, 2451545. + k, 1. / 1440.);
+    atime_lst_stepper_fill(&st, lst, NBLOCK);
+    sum += lst[k % NBLOCK];
+  }
+  bench_report("atime_lst_stepper_fill()", ncall, bench_seconds() - t0,
+	       ref);
+  
+  printf("(checksum %g)\n", sum);
+  
+  free(year);
+  free(month);
+  free(day);
+  free(jd);
+  free(lst);
+  
+  return 0;
+}
@@ -0,0 +1,95 @@
+/******** test_atime_array.c ********/
+/* Tests of the array time routines against their scalar forms:
+   atime_jd_array() must equal atime_jd() exactly, and atime_lst_array()
+   & the LST stepper must agree with atime_lst() (to 1e-6 degree, which
+   allows for the different jd_0h of atime_lst()).  Returns 0 on success.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <tpeb.h>
+
+#define NTEST 200000
+
+static double lst_diff(double a, double b);
+
+
+int main(void){
+  
+  /* Variable Declarations */
+  int i,nbad=0,*year,*month;
+  double *day,*jd,*lst,lon,d,worst=0.;
+  atime_lst_stepper st;
+  
+  year  = (int *)malloc(NTEST * sizeof(int));
+  month = (int *)malloc(NTEST * sizeof(int));
+  day   = (double *)malloc(NTEST * sizeof(double));
+  jd    = (double *)malloc(NTEST * sizeof(double));
+  lst   = (double *)malloc(NTEST * sizeof(double));
+  
+  /* Calendar dates, 1000 to 3000 (both calendars) */
+  srand(13);
+  for(i=0; i<NTEST; i++){
+    year[i]  = 1000 + rand() % 2000;
+    month[i] = 1 + rand() % 12;
+    day[i]   = 1 + rand() % 28 + rand() / ((double)RAND_MAX + 1.);
+  }
+  atime_jd_array(year, month, day, NTEST, jd);
+  for(i=0; i<NTEST; i++)
+    if(jd[i] != atime_jd(year[i], month[i], day[i])){
+      if(nbad++ < 10)
+	printf("atime_jd_array %d-%02d-%09.6f:  %.9f (scalar %.9f)\n",
+	       year[i], month[i], day[i], jd[i],
+	       atime_jd(year[i], month[i], day[i]));
+    }
+  
+  /* LST at the same instants, from a random longitude */
+  lon = 360. * rand() / ((double)RAND_MAX + 1.) - 180.;
+  atime_lst_array(lon, jd, NTEST, lst);
+  for(i=0; i<NTEST; i++){
+    d = lst_diff(lst[i], atime_lst(lon, jd[i]));
+    if(d > worst)
+      worst = d;
+    if(!(lst[i] >= 0. && lst[i] < 360.) || d > 1.e-6){
+      if(nbad++ < 10)
+	printf("atime_lst_array JD %.6f:  %.9f (scalar %.9f)\n", jd[i],
+	       lst[i], atime_lst(lon, jd[i]));
+    }
+  }
+  
+  /* Stepper over a one-minute grid, across several re-anchors */
+  atime_lst_stepper_init(&st, lon, 2451545.25, 1. / 1440.);
+  atime_lst_stepper_fill(&st, lst, NTEST);
+  for(i=0; i<NTEST; i++){
+    d = lst_diff(lst[i], atime_lst(lon, 2451545.25 + i / 1440.));
+    if(d > worst)
+      worst = d;
+    if(d > 1.e-6){
+      if(nbad++ < 10)
+	printf("Stepper %d:  %.9f (scalar %.9f)\n", i, lst[i],
+	       atime_lst(lon, 2451545.25 + i / 1440.));
+    }
+  }
+  
+  free(year);
+  free(month);
+  free(day);
+  free(jd);
+  free(lst);
+  
+  if(nbad)
+    printf("test_atime_array:  %d failures (worst LST %.3g deg)\n", nbad,
+	   worst);
+  
+  return (nbad) ? 1 : 0;
+}
+
+
+/* Difference of two angles in degrees, across the 0/360 wrap */
+static double lst_diff(double a, double b){
+  
+  return fabs(remainder(a - b, 360.));
+}
@@ -0,0 +1,134 @@
+/******** test_atime_iso.c ********/
+/* Round-trip tests for atime_iso_to_jd() & atime_jd_to_iso():  every day
+   from 1601 to 9999 (Gregorian in atime_jd() as well) is written at 0-3
+   decimals and must read back to the same string, plus fixed dates and
+   strings that must be rejected.  Returns 0 on success.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <tpeb.h>
+
+static int check_every_day(void);
+static int check_known(void);
+static int check_rejects(void);
+
+
+int main(void){
+  
+  /* Variable Declarations */
+  int nbad=0;
+  
+  nbad += check_every_day();
+  nbad += check_known();
+  nbad += check_rejects();
+  
+  if(nbad)
+    printf("test_atime_iso:  %d failures\n", nbad);
+  
+  return (nbad) ? 1 : 0;
+}
+
+
+/* Every day, at a random time of day, written & read back */
+static int check_every_day(void){
+  
+  /* Variable Declarations */
+  int nbad=0,nd;
+  long k;
+  double jd,back,mjd,day0,day1;
+  char buf[40],again[40];
+  
+  day0 = atime_jd(1601, 1, 1.);
+  day1 = atime_jd(10000, 1, 1.);
+  srand(15);
+  
+  for(k=0; day0 + k < day1; k++){
+    nd = k % 4;
+    jd = day0 + k + rand() / ((double)RAND_MAX + 1.);
+    
+    if(atime_jd_to_iso(jd, nd, buf, sizeof(buf)) != 19 + ((nd) ? nd + 1 : 0) ||
+       atime_iso_to_jd(buf, strlen(buf), &back, &mjd) != 0 ||
+       atime_jd_to_iso(back, nd, again, sizeof(again)) < 0 ||
+       strcmp(buf, again) != 0 ||
+       fabs(back - jd) * 86400. > 0.5 * pow(10., -nd) + 1.e-4 ||
+       fabs(mjd - (back - 2400000.5)) > 1.e-8){
+      if(nbad++ < 10)
+	printf("Day %ld:  %.9f -> %s -> %.9f -> %s\n", k, jd, buf, back,
+	       again);
+    }
+  }
+  
+  return nbad;
+}
+
+
+/* Dates with known JDs, in the accepted spellings */
+static int check_known(void){
+  
+  /* Variable Declarations */
+  int i,nbad=0;
+  double jd,mjd;
+  char buf[40];
+  static const struct {
+    const char *str;
+    double jd;
+  } known[] = {
+    {"2000-01-01T12:00:00",            2451545.0},
+    {"2000-01-01 12:00:00.000Z",       2451545.0},
+    {"'1858-11-17T00:00:00'",          2400000.5},
+    {"  1858-11-17  ",                 2400000.5},
+    {"2000-03-01T06:00",               2451604.75},
+    {"1999-12-31T23:59:60.5",          2451544.5 + 0.5 / 86400.},
+    {"01/01/00",                       2415020.5},
+    {"2024-02-29T18:00:00.25",         2460370.25 + 0.25 / 86400.}
+  };
+  
+  for(i=0; i<(int)(sizeof(known) / sizeof(known[0])); i++){
+    if(atime_iso_to_jd(known[i].str, strlen(known[i].str), &jd, &mjd) != 0 ||
+       fabs(jd - known[i].jd) > 1.e-9 ||
+       fabs(mjd - (known[i].jd - 2400000.5)) > 1.e-9){
+      if(nbad++ < 10)
+	printf("Known '%s':  %.9f (expected %.9f)\n", known[i].str, jd,
+	       known[i].jd);
+    }
+  }
+  
+  // Carry from 59.9995s up through the date
+  atime_jd_to_iso(2451544.5 - 0.0004 / 86400., 3, buf, sizeof(buf));
+  if(strcmp(buf, "2000-01-01T00:00:00.000")){
+    printf("Carry:  %s\n", buf);
+    nbad++;
+  }
+  
+  return nbad;
+}
+
+
+/* Strings that are not dates */
+static int check_rejects(void){
+  
+  /* Variable Declarations */
+  int i,nbad=0;
+  double jd,mjd;
+  static const char *bad[] = {
+    "", "2000", "2000-01-01T", "2000-01-01T12", "2000-01-01T12:00:",
+    "2000-01-01T12:00:0", "2000-01-01T12:00:00.", "2000-01-01T12:00:00.x",
+    "2000-01-01T12:00:00.5.5", "2000-1-01", "2000-13-01", "2000-00-10",
+    "2000-02-30", "2001-02-29", "1900-02-29", "2000-01-01T24:00",
+    "2000-01-01T12:60", "2000-01-01X12:00", "32/01/00", "01/01/0a"
+  };
+  
+  for(i=0; i<(int)(sizeof(bad) / sizeof(bad[0])); i++){
+    if(atime_iso_to_jd(bad[i], strlen(bad[i]), &jd, &mjd) != -1){
+      if(nbad++ < 10)
+	printf("Accepted '%s'\n", bad[i]);
+    }
+  }
+  
+  return nbad;
+}
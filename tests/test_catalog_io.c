@@ -0,0 +1,152 @@
+/******** test_catalog_io.c ********/
+/* Write -> read round trips of the catalog writers & readers (lib, lib
+   through the memory map, MMT & TUI), over rows with real positions and
+   rows with no position (NAN RA & Dec).  Positions must read back to the
+   precision written, and a NAN coordinate must read back as NAN -- never
+   as 00:00:00 / +00:00:00.  Positions that are malformed or out of range
+   must also read as NAN, and rows without a position must never match in
+   xmatch_lib().  Returns 0 on success.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <tpeb.h>
+
+#define NROW 6
+
+static int check_row(const char *what, int i, double ra, double dec,
+		     double ra_in, double dec_in, double tol);
+
+// Positions written:  row 1 has none, row 4 no RA
+static const double ra_in[NROW]  = {10.25, NAN, 187.5, 359.99, NAN, 0.};
+static const double dec_in[NROW] = {-30.5, NAN, 10.5, 89.9, 45., -0.25};
+
+
+int main(void){
+  
+  /* Variable Declarations */
+  int i,n,np,nbad=0;
+  FILE *fp;
+  xmatch_pair *pairs;
+  catalog_lib lib[NROW],*lib_back;
+  catalog_mmt mmt[NROW],*mmt_back;
+  catalog_tui tui[NROW],*tui_back;
+  
+  memset(lib, 0, sizeof(lib));
+  memset(mmt, 0, sizeof(mmt));
+  memset(tui, 0, sizeof(tui));
+  for(i=0; i<NROW; i++){
+    sprintf(lib[i].id, "star%d", i);
+    strcpy(mmt[i].id, lib[i].id);
+    strcpy(tui[i].id, lib[i].id);
+    lib[i].ra  = mmt[i].ra  = tui[i].ra  = ra_in[i];
+    lib[i].dec = mmt[i].dec = tui[i].dec = dec_in[i];
+    lib[i].epoch = mmt[i].epoch = 2000.;
+    strcpy(lib[i].spectyp, "G2V");
+    strcpy(mmt[i].spectyp, "G2V");
+  }
+  
+  /* Lib, through both writers */
+  catalog_write_lib("test_catalog_io.lib", lib, NROW);
+  lib_back = catalog_read_lib("test_catalog_io.lib", &n);
+  if(n != NROW)
+    nbad++;
+  for(i=0; i<n && i<NROW; i++)
+    nbad += check_row("lib", i, lib_back[i].ra, lib_back[i].dec, ra_in[i],
+		      dec_in[i], 0.001 / 240.);
+  
+  // Matched against itself, only the rows with a position pair up
+  pairs = xmatch_lib(lib_back, n, lib_back, n, 1. / 3600., XMATCH_BEST, 2,
+		     &np);
+  if(np != 4)
+    nbad++;
+  for(i=0; i<np; i++)
+    if(pairs[i].i1 != pairs[i].i2 || isnan(ra_in[pairs[i].i1]) ||
+       isnan(dec_in[pairs[i].i1]))
+      nbad++;
+  free(pairs);
+  free(lib_back);
+  
+  catalog_write_lib_mmap("test_catalog_io.lib", lib, NROW, 2);
+  lib_back = catalog_read_lib_mmap("test_catalog_io.lib", &n);
+  if(n != NROW)
+    nbad++;
+  for(i=0; i<n && i<NROW; i++)
+    nbad += check_row("lib mmap", i, lib_back[i].ra, lib_back[i].dec,
+		      ra_in[i], dec_in[i], 0.001 / 240.);
+  free(lib_back);
+  
+  /* MMT */
+  catalog_write_mmt("test_catalog_io.mmt", mmt, NROW);
+  mmt_back = catalog_read_mmt("test_catalog_io.mmt", &n);
+  if(n != NROW)
+    nbad++;
+  for(i=0; i<n && i<NROW; i++)
+    nbad += check_row("mmt", i, mmt_back[i].ra, mmt_back[i].dec, ra_in[i],
+		      dec_in[i], 0.001 / 240.);
+  free(mmt_back);
+  
+  /* TUI */
+  catalog_write_tui("test_catalog_io.tui", tui, NROW);
+  tui_back = catalog_read_tui("test_catalog_io.tui", &n);
+  if(n != NROW)
+    nbad++;
+  for(i=0; i<n && i<NROW; i++)
+    nbad += check_row("tui", i, tui_back[i].ra, tui_back[i].dec, ra_in[i],
+		      dec_in[i], 0.01 / 240.);
+  free(tui_back);
+  
+  /* Malformed & out-of-range positions */
+  fp = fopen("test_catalog_io.tui", "w");
+  fprintf(fp, "good 01:00:00.0 +10:00:00\n"
+	  "range 25:00:00.0 +10:00:00\n"
+	  "syntax 01:xx:00.0 +10:00:00\n");
+  fclose(fp);
+  tui_back = catalog_read_tui("test_catalog_io.tui", &n);
+  if(n != 3 || fabs(tui_back[0].ra - 15.) > 1.e-9 ||
+     fabs(tui_back[0].dec - 10.) > 1.e-9)
+    nbad++;
+  for(i=1; i<n; i++)
+    if(!isnan(tui_back[i].ra) || !isnan(tui_back[i].dec)){
+      printf("tui bad row %d:  %.9f %.9f\n", i, tui_back[i].ra,
+	     tui_back[i].dec);
+      nbad++;
+    }
+  free(tui_back);
+  
+  remove("test_catalog_io.lib");
+  remove("test_catalog_io.mmt");
+  remove("test_catalog_io.tui");
+  
+  if(nbad)
+    printf("test_catalog_io:  %d failures\n", nbad);
+  
+  return (nbad) ? 1 : 0;
+}
+
+
+/* One row read back:  a NAN coordinate must stay NAN (the readers that
+   scan RA & Dec as a pair make both NAN), others within tol degrees */
+static int check_row(const char *what, int i, double ra, double dec,
+		     double ra_in, double dec_in, double tol){
+  
+  /* Variable Declarations */
+  int pair,ok_ra,ok_dec;
+  
+  pair   = isnan(ra_in) || isnan(dec_in);
+  ok_ra  = (isnan(ra_in)) ? isnan(ra) :
+    (fabs(remainder(ra - ra_in, 360.)) <= tol || (pair && isnan(ra)));
+  ok_dec = (isnan(dec_in)) ? isnan(dec) :
+    (fabs(dec - dec_in) <= tol || (pair && isnan(dec)));
+  if(ok_ra && ok_dec)
+    return 0;
+  
+  printf("%s row %d:  %.9f %.9f (wrote %.9f %.9f)\n", what, i, ra, dec,
+	 ra_in, dec_in);
+  
+  return 1;
+}
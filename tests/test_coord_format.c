@@ -0,0 +1,184 @@
+/******** test_coord_format.c ********/
+/* Round-trip tests for coord_format_dms():  every tick of the last digit
+   over the full range (RA at 0.1s, Dec at 1") is checked against an
+   integer sprintf() layout & read back with coord_parserd(); random
+   values at 0-6 decimals are checked to read back within half a unit,
+   with the carry never leaving 60 in a field, & values that cannot be
+   formatted (NAN, too large) must be refused.  Returns 0 on success.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <tpeb.h>
+
+static int check_ra_ticks(void);
+static int check_dec_ticks(void);
+static int check_random(long n);
+static int check_limits(void);
+
+
+int main(void){
+  
+  /* Variable Declarations */
+  int nbad=0;
+  
+  nbad += check_ra_ticks();
+  nbad += check_dec_ticks();
+  nbad += check_random(1000000);
+  nbad += check_limits();
+  
+  if(nbad)
+    printf("test_coord_format:  %d failures\n", nbad);
+  
+  return (nbad) ? 1 : 0;
+}
+
+
+/* Every RA from 00:00:00.0 to 23:59:59.9 in steps of 0.1s */
+static int check_ra_ticks(void){
+  
+  /* Variable Declarations */
+  int nbad=0;
+  long long t,s;
+  char buf[COORD_FMT_LEN],expect[COORD_FMT_LEN],line[128],again[COORD_FMT_LEN];
+  astrom_coords obj;
+  
+  for(t=0; t<864000; t++){
+    s = t / 10;
+    sprintf(expect, "%02lld:%02lld:%02lld.%lld", s / 3600, (s / 60) % 60,
+	    s % 60, t % 10);
+    coord_format_dms(t / 10. / 240., COORD_RA, 1, buf, sizeof(buf));
+    
+    sprintf(line, "%s +00:00:00.0", buf);
+    obj = coord_parserd(line);
+    coord_format_dms(obj.ra, COORD_RA, 1, again, sizeof(again));
+    
+    if(strcmp(buf, expect) || strcmp(buf, again)){
+      if(nbad++ < 10)
+	printf("RA tick %lld:  %s (expected %s, read back %s)\n", t, buf,
+	       expect, again);
+    }
+  }
+  
+  return nbad;
+}
+
+
+/* Every Dec from -90:00:00 to +90:00:00 in steps of 1" */
+static int check_dec_ticks(void){
+  
+  /* Variable Declarations */
+  int nbad=0;
+  long long t,s;
+  char buf[COORD_FMT_LEN],expect[COORD_FMT_LEN],line[128],again[COORD_FMT_LEN];
+  astrom_coords obj;
+  
+  for(t=-324000; t<=324000; t++){
+    s = llabs(t);
+    sprintf(expect, "%c%02lld:%02lld:%02lld", (t < 0) ? '-' : '+',
+	    s / 3600, (s / 60) % 60, s % 60);
+    coord_format_dms(t / 3600., COORD_DEC, 0, buf, sizeof(buf));
+    
+    sprintf(line, "00:00:00.00 %s", buf);
+    obj = coord_parserd(line);
+    coord_format_dms(obj.dec, COORD_DEC, 0, again, sizeof(again));
+    
+    if(strcmp(buf, expect) || strcmp(buf, again)){
+      if(nbad++ < 10)
+	printf("Dec tick %lld:  %s (expected %s, read back %s)\n", t, buf,
+	       expect, again);
+    }
+  }
+  
+  return nbad;
+}
+
+
+/* Random RA & Dec at 0-6 decimals, many of them on a rounding tie */
+static int check_random(long n){
+  
+  /* Variable Declarations */
+  int nbad=0,nd,rd,dd;
+  long i;
+  double ra,dec,unit,half;
+  char rabuf[COORD_FMT_LEN],decbuf[COORD_FMT_LEN],line[128];
+  astrom_coords obj;
+  
+  srand(2009);
+  for(i=0; i<n; i++){
+    nd   = i % 7;
+    unit = pow(10., -nd);
+    half = 0.5 * unit + 1e-9;       // Ties may go either way
+    
+    ra  = 360. * rand() / ((double)RAND_MAX + 1.);
+    dec = 180. * rand() / ((double)RAND_MAX + 1.) - 90.;
+    if(i % 3 == 0){
+      // Half a unit below a whole minute, so the carry runs up
+      ra  = floor(ra / 0.25) * 0.25 - 0.5 * unit / 240.;
+      dec = (floor(dec * 60.) + 1.) / 60. - 0.5 * unit / 3600.;
+    }
+    if(ra < 0.)
+      ra += 360.;
+    
+    coord_format_dms(ra, COORD_RA, nd, rabuf, sizeof(rabuf));
+    coord_format_dms(dec, COORD_DEC, nd, decbuf, sizeof(decbuf));
+    sprintf(line, "%s %s", rabuf, decbuf);
+    obj = coord_parserd(line);
+    
+    // Minutes & seconds fields (after the first & second ':')
+    rd = atoi(strchr(rabuf, ':') + 1) < 60 &&
+      atoi(strrchr(rabuf, ':') + 1) < 60;
+    dd = atoi(strchr(decbuf, ':') + 1) < 60 &&
+      atoi(strrchr(decbuf, ':') + 1) < 60;
+    
+    if(!rd || !dd ||
+       fabs(remainder(obj.ra - ra, 360.)) * 240. > half ||
+       fabs(obj.dec - dec) * 3600. > half){
+      if(nbad++ < 10)
+	printf("Random %ld:  %.12f %.12f -> %s\n", i, ra, dec, line);
+    }
+  }
+  
+  return nbad;
+}
+
+
+/* Values that cannot be formatted, & a buffer that is too short */
+static int check_limits(void){
+  
+  /* Variable Declarations */
+  int nbad=0;
+  char buf[COORD_FMT_LEN],text[64];
+  static const double bad_ra[2] = {NAN, 15.}, bad_dec[2] = {1e300, 1.};
+  
+  if(coord_format_dms(1e300, COORD_DEC, 2, buf, sizeof(buf)) != -1)
+    nbad++;
+  if(coord_format_dms(-1e20, COORD_DEC, 0, buf, sizeof(buf)) != -1)
+    nbad++;
+  if(coord_format_dms(12.5, COORD_DEC, 1, buf, 8) != -1)
+    nbad++;
+  if(coord_format_dms(NAN, COORD_DEC, 1, buf, sizeof(buf)) != -1 ||
+     coord_format_dms(NAN, COORD_RA, 2, buf, sizeof(buf)) != -1 ||
+     coord_format_dms(-INFINITY, COORD_DEC, 1, buf, sizeof(buf)) != -1)
+    nbad++;                         // Never a real position
+  coord_degtodms(NAN, buf, COORD_RA);
+  if(buf[0] != '\0')
+    nbad++;
+  if(coord_format_rd_array(bad_ra, bad_dec, 2, text, sizeof(text)) < 0 ||
+     strcmp(text, "nan nan\n01:00:00.00 +01:00:00.0\n") != 0)
+    nbad++;                         // Arrays write "nan" & carry on
+  if(coord_format_dms(1e300, COORD_RA, 2, buf, sizeof(buf)) < 0)
+    nbad++;                         // RA is wrapped first, so it fits
+  if(coord_format_dms(-0.4 / 3600., COORD_DEC, 0, buf, sizeof(buf)) < 0 ||
+     strcmp(buf, "-00:00:00") != 0)
+    nbad++;                         // Sign kept when it rounds to zero
+  
+  if(nbad)
+    printf("Limits:  %d failures\n", nbad);
+  
+  return nbad;
+}
@@ -0,0 +1,212 @@
+/******** test_coord_scan.c ********/
+/* Tests of the one-pass coordinate scanner, coord_scan_rd() &
+   coord_scan_angle():  colon, blank & decimal-degree forms, the sign of
+   '-00', decimal minutes, over-long fields, the COORD_ERANGE &
+   COORD_ESYNTAX cases, and bit-for-bit agreement with coord_parserd()
+   on random colon-delimited pairs.  Returns 0 on success.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <tpeb.h>
+
+static int check_table(void);
+static int check_parserd(long n);
+static int check_long_fields(void);
+static int check_angle(void);
+
+
+int main(void){
+  
+  /* Variable Declarations */
+  int nbad=0;
+  
+  nbad += check_table();
+  nbad += check_parserd(500000);
+  nbad += check_long_fields();
+  nbad += check_angle();
+  
+  if(nbad)
+    printf("test_coord_scan:  %d failures\n", nbad);
+  
+  return (nbad) ? 1 : 0;
+}
+
+
+/* Fixed pairs, with the status & degrees expected */
+static int check_table(void){
+  
+  /* Variable Declarations */
+  int i,st,nbad=0;
+  astrom_coords obj;
+  static const struct {
+    const char *str;
+    int    status;
+    double ra,dec;
+  } cases[] = {
+    {"12:30:00.00 +10:30:00.0",   COORD_OK,      187.5,   10.5},
+    {"12 30 00.00 +10 30 00.0",   COORD_OK,      187.5,   10.5},
+    {" 12:30:00\t-10:30:00 \n",   COORD_OK,      187.5,  -10.5},
+    {"12:30 +10:30",              COORD_OK,      187.5,   10.5},
+    {"12:59.5 +10:30.5",          COORD_OK,  194.875, 10.5083333333333333},
+    {"12 59.5 10 30.5",           COORD_OK,  194.875, 10.5083333333333333},
+    {"187.5 -10.5",               COORD_OK,      187.5,  -10.5},
+    {"0.0000000000000000001 0.0", COORD_OK,      1e-19,    0.},
+    {"00:00:00 -00:30:00",        COORD_OK,         0.,   -0.5},
+    {"12:60.0 +10:30",            COORD_ERANGE,    NAN,    NAN},
+    {"12:30:60 +10:30:00",        COORD_ERANGE,    NAN,    NAN},
+    {"24:00:00 +10:30:00",        COORD_ERANGE,    NAN,    NAN},
+    {"12:00:00 +90:00:01",        COORD_ERANGE,    NAN,    NAN},
+    {"12:00:00 +91:00:00",        COORD_ERANGE,    NAN,    NAN},
+    {"360.0 +10.0",               COORD_ERANGE,    NAN,    NAN},
+    {"",                          COORD_ESYNTAX,   NAN,    NAN},
+    {"12:30:00",                  COORD_ESYNTAX,   NAN,    NAN},
+    {"12:30: +10:30",             COORD_ESYNTAX,   NAN,    NAN},
+    {"12:30:00 +10:30:00 5",      COORD_ESYNTAX,   NAN,    NAN},
+    {"12:3a:00 +10:30:00",        COORD_ESYNTAX,   NAN,    NAN},
+    {"12:30.5:00 +10:30:00",      COORD_ESYNTAX,   NAN,    NAN},
+    {"12:30:00 +10:-30:00",       COORD_ESYNTAX,   NAN,    NAN},
+    {"12:30:00 +10 30 00",        COORD_ESYNTAX,   NAN,    NAN},
+    {"12 30 +10",                 COORD_ESYNTAX,   NAN,    NAN},
+    {"1.2.3 +10.0",               COORD_ESYNTAX,   NAN,    NAN},
+    {"abc def",                   COORD_ESYNTAX,   NAN,    NAN}
+  };
+  
+  for(i=0; i<(int)(sizeof(cases) / sizeof(cases[0])); i++){
+    st = coord_scan_rd(cases[i].str, strlen(cases[i].str), &obj);
+    if(st != cases[i].status ||
+       (st == COORD_OK && (fabs(obj.ra - cases[i].ra) > 1.e-12 ||
+			   fabs(obj.dec - cases[i].dec) > 1.e-12)) ||
+       (st == COORD_ESYNTAX && !(isnan(obj.ra) && isnan(obj.dec)))){
+      if(nbad++ < 10)
+	printf("'%s':  status %d, %.15g %.15g (expected %d)\n", cases[i].str,
+	       st, obj.ra, obj.dec, cases[i].status);
+    }
+  }
+  
+  // The sign of '-00' degrees, & a length that stops before the null
+  coord_scan_rd("00:00:00 -00:00:00", 18, &obj);
+  if(!signbit(obj.dec)){
+    printf("'-00:00:00' lost its sign\n");
+    nbad++;
+  }
+  if(coord_scan_rd("12:30:00 +10:30:00 junk", 18, &obj) != COORD_OK ||
+     obj.dec != 10.5){
+    printf("Length limit not honored\n");
+    nbad++;
+  }
+  
+  return nbad;
+}
+
+
+/* Random colon pairs (0-15 decimals) must match coord_parserd() bit for
+   bit, and the blank-separated form must match the colon form */
+static int check_parserd(long n){
+  
+  /* Variable Declarations */
+  int nbad=0,rd,dd,dsign;
+  long i;
+  char line[128],blank[128];
+  astrom_coords ref,obj,obj2;
+  
+  srand(22);
+  for(i=0; i<n; i++){
+    rd    = rand() % 16;
+    dd    = rand() % 16;
+    dsign = rand() % 2;
+    sprintf(line, "%02d:%02d:%0*.*f %c%02d:%02d:%0*.*f", rand() % 24,
+	    rand() % 60, rd + 3 - (rd == 0), rd,
+	    59. * rand() / RAND_MAX, (dsign) ? '-' : '+', rand() % 90,
+	    rand() % 60, dd + 3 - (dd == 0), dd, 59. * rand() / RAND_MAX);
+    ref = coord_parserd(line);
+    
+    strcpy(blank, line);
+    *strchr(blank, ':') = ' ';
+    *strchr(blank, ':') = ' ';
+    *strchr(blank, ':') = ' ';
+    *strchr(blank, ':') = ' ';
+    
+    if(coord_scan_rd(line, strlen(line), &obj) != COORD_OK ||
+       coord_scan_rd(blank, strlen(blank), &obj2) != COORD_OK ||
+       memcmp(&obj.ra, &ref.ra, sizeof(double)) ||
+       memcmp(&obj.dec, &ref.dec, sizeof(double)) ||
+       obj2.ra != obj.ra || obj2.dec != obj.dec){
+      if(nbad++ < 10)
+	printf("'%s':  %.17g %.17g (coord_parserd %.17g %.17g)\n", line,
+	       obj.ra, obj.dec, ref.ra, ref.dec);
+    }
+  }
+  
+  return nbad;
+}
+
+
+/* Fields past the exact fast path go to strtod(); too long is an error */
+static int check_long_fields(void){
+  
+  /* Variable Declarations */
+  int i,nbad=0;
+  double deg;
+  char line[128];
+  static const char *sec[] = {
+    "30.123456789012345678", "30.1234567890123456789012",
+    "0.00000000000000000000000001", "1234567890123456789.5",
+    "59.9999999999999999999"
+  };
+  
+  for(i=0; i<(int)(sizeof(sec) / sizeof(sec[0])); i++){
+    sprintf(line, "10:20:%s", sec[i]);
+    coord_scan_angle(line, strlen(line), COORD_DEC, &deg);
+    if(deg != 10. + (20. / 60.) + (strtod(sec[i], NULL) / 3600.)){
+      if(nbad++ < 10)
+	printf("'%s':  %.17g\n", line, deg);
+    }
+  }
+  
+  // Longer than COORD_NUM_LEN characters
+  strcpy(line, "10:20:30.");
+  for(i=0; i<80; i++)
+    strcat(line, "1");
+  if(coord_scan_angle(line, strlen(line), COORD_DEC, &deg) != COORD_ESYNTAX){
+    printf("Over-long field accepted\n");
+    nbad++;
+  }
+  
+  return nbad;
+}
+
+
+/* Single angles */
+static int check_angle(void){
+  
+  /* Variable Declarations */
+  int nbad=0;
+  double deg;
+  
+  if(coord_scan_angle("-00:30:00", 9, COORD_DEC, &deg) != COORD_OK ||
+     deg != -0.5)
+    nbad++;
+  if(coord_scan_angle("06:00:00", 8, COORD_RA, &deg) != COORD_OK ||
+     deg != 90.)
+    nbad++;
+  if(coord_scan_angle("06 00 00", 8, COORD_LST, &deg) != COORD_OK ||
+     deg != 90.)
+    nbad++;
+  if(coord_scan_angle("-06:00:00", 9, COORD_RA, &deg) != COORD_ERANGE)
+    nbad++;
+  if(coord_scan_angle("06:00 00", 8, COORD_RA, &deg) != COORD_ESYNTAX ||
+     !isnan(deg))
+    nbad++;
+  if(coord_scan_angle("1:2:3:4", 7, COORD_DEC, &deg) != COORD_ESYNTAX)
+    nbad++;
+  
+  if(nbad)
+    printf("Single angles:  %d failures\n", nbad);
+  
+  return nbad;
+}
@@ -0,0 +1,146 @@
+/******** test_threads.c ********/
+/* Reentrancy test:  coord_parserd(), coord_dmstodeg() & the fitswrap
+   DATE-MOD / TIME-MOD stamp are run over the same inputs from several
+   threads at once, & every thread's results must match a serial pass
+   (and the shared dms arrays must come back untouched).  Returns 0 on
+   success.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <tpeb.h>
+
+#define NTEST    20000  // Inputs of each kind
+#define NTHREAD  8      // Threads run at once
+#define NPASS    10     // Passes over the inputs per thread
+
+// Shared inputs & the serial results
+typedef struct {
+  char          line[NTEST][64];
+  double        dms[NTEST][3];    // Passed straight to every thread
+  double        dms_copy[NTEST][3];
+  time_t        when[NTEST];
+  astrom_coords rd[NTEST];
+  double        deg[NTEST];
+  char          date[NTEST][FLEN_VALUE];
+  char          time[NTEST][FLEN_VALUE];
+} threads_input;
+
+// Per-thread work block
+typedef struct {
+  threads_input *in;
+  int nbad;
+} threads_work;
+
+static void  threads_setup(threads_input *in);
+static void *threads_worker(void *arg);
+
+
+int main(void){
+  
+  /* Variable Declarations */
+  int i,nbad=0;
+  threads_input *in;
+  threads_work work[NTHREAD];
+  
+  in = (threads_input *)malloc(sizeof(threads_input));
+  threads_setup(in);
+  
+  for(i=0; i<NTHREAD; i++){
+    work[i].in   = in;
+    work[i].nbad = 0;
+  }
+  parallel_run(NTHREAD, threads_worker, work, sizeof(threads_work));
+  
+  for(i=0; i<NTHREAD; i++){
+    if(work[i].nbad)
+      printf("Thread %d:  %d mismatches\n", i, work[i].nbad);
+    nbad += work[i].nbad;
+  }
+  
+  // coord_dmstodeg() must not have changed the shared arrays
+  if(memcmp(in->dms, in->dms_copy, sizeof(in->dms))){
+    printf("Shared dms arrays were modified\n");
+    nbad++;
+  }
+  
+  free(in);
+  if(nbad)
+    printf("test_threads:  %d failures\n", nbad);
+  
+  return (nbad) ? 1 : 0;
+}
+
+
+/* Function to build the inputs & the serial results to check against */
+static void threads_setup(threads_input *in){
+  
+  /* Variable Declarations */
+  int i;
+  double ra,dec;
+  char rabuf[COORD_FMT_LEN],decbuf[COORD_FMT_LEN];
+  
+  srand(1616);
+  for(i=0; i<NTEST; i++){
+    in->dms[i][0] = (rand() % 181) - 90;
+    in->dms[i][1] = rand() % 60;
+    in->dms[i][2] = (rand() % 60000) / 1000.;
+    if(i % 50 == 0)
+      in->dms[i][0] = -0.;          // The "-00" case
+  }
+  memcpy(in->dms_copy, in->dms, sizeof(in->dms));
+  
+  for(i=0; i<NTEST; i++){
+    ra  = 360. * rand() / ((double)RAND_MAX + 1.);
+    dec = 180. * rand() / ((double)RAND_MAX + 1.) - 90.;
+    if(i % 50 == 0)
+      dec = -0.5 * rand() / ((double)RAND_MAX + 1.);
+    coord_format_dms(ra, COORD_RA, 2, rabuf, sizeof(rabuf));
+    coord_format_dms(dec, COORD_DEC, 1, decbuf, sizeof(decbuf));
+    sprintf(in->line[i], "%s %s", rabuf, decbuf);
+    
+    // Spread over 1970-2037, local time
+    in->when[i] = (time_t)(2.1e9 * rand() / ((double)RAND_MAX + 1.));
+    
+    in->rd[i]  = coord_parserd(in->line[i]);
+    in->deg[i] = coord_dmstodeg(in->dms[i], (i % 2) ? COORD_RA : COORD_DEC);
+    fitswrap_timestamp(in->when[i], in->date[i], in->time[i]);
+  }
+  
+  return;
+}
+
+
+/* Worker:  repeat the serial calls & count any result that differs */
+static void *threads_worker(void *arg){
+  
+  /* Variable Declarations */
+  int i,k;
+  double deg;
+  char date[FLEN_VALUE],time[FLEN_VALUE],line[64];
+  astrom_coords rd;
+  threads_work *w = (threads_work *)arg;
+  threads_input *in = w->in;
+  
+  for(k=0; k<NPASS; k++){
+    for(i=0; i<NTEST; i++){
+      strcpy(line, in->line[i]);
+      rd = coord_parserd(line);
+      
+      deg = coord_dmstodeg(in->dms[i], (i % 2) ? COORD_RA : COORD_DEC);
+      
+      fitswrap_timestamp(in->when[i], date, time);
+      
+      if(rd.ra != in->rd[i].ra || rd.dec != in->rd[i].dec ||
+	 signbit(rd.dec) != signbit(in->rd[i].dec) || deg != in->deg[i] ||
+	 strcmp(date, in->date[i]) || strcmp(time, in->time[i]))
+	w->nbad++;
+    }
+  }
+  
+  return NULL;
+}